@@ -28,6 +28,7 @@ void cmd_entry(int argc, char **argv) {
             {"target", required_argument, NULL, 1},
             {"ld", required_argument, NULL, 2},
             {"ldflags", required_argument, NULL, 3},
+            {"arm64-lse", no_argument, NULL, 4},
             {NULL, 0, NULL, 0}};
 
     int option_index = 0;
@@ -111,6 +112,11 @@ void cmd_entry(int argc, char **argv) {
                 strcpy(LDFLAGS, optarg);
                 break;
             }
+            case 4: {
+                // 处理 --arm64-lse 参数, 目标 cpu 需要支持 ARMv8.1 LSE 原子指令
+                BUILD_ARM64_LSE = true;
+                break;
+            }
             default:
                 break;
         }
@@ -17,6 +17,7 @@
 #include <stdio.h>
 
 #include "runtime/runtime.h"
+#include "runtime/processor.h"
 
 // this header including should be at the last of the `include` directives list
 
@@ -330,7 +331,7 @@ void aco_create_init(aco_t *aco, aco_t *main_co, aco_share_stack_t *share_stack,
             save_stack_sz = 64;
         }
 
-        aco->save_stack.ptr = rti_gc_malloc(save_stack_sz, NULL);
+        aco->save_stack.ptr = save_stack_alloc(&save_stack_sz);
         DEBUGF("[aco_create_init] save_stack.ptr=%p, size=%ld", aco->save_stack.ptr, save_stack_sz);
 
         assert(aco->save_stack.ptr);
@@ -375,18 +376,12 @@ aco_attr_no_asan void aco_resume(aco_t *resume_co) {
             owner_co->save_stack.valid_sz =
                     (uintptr_t) (owner_co->share_stack->align_retptr) - (uintptr_t) (owner_co->reg[ACO_REG_IDX_SP]);
 
-            // save 栈增长
+            // save 栈增长, 预留 1/4 的空间避免栈深度在 size class 边界附近波动时反复增长
+            // 旧的 save_stack 归还到 processor 缓存中供其他 coroutine 复用
             if (owner_co->save_stack.sz < owner_co->save_stack.valid_sz) {
-                owner_co->save_stack.ptr = NULL;
-                while (1) {
-                    owner_co->save_stack.sz = owner_co->save_stack.sz << 1;
-                    assert(owner_co->save_stack.sz > 0);
-                    if (owner_co->save_stack.sz >= owner_co->save_stack.valid_sz) {
-                        break;
-                    }
-                }
-                // gc malloc TODO write_barrier
-                owner_co->save_stack.ptr = rti_gc_malloc(owner_co->save_stack.sz, NULL);
+                save_stack_release(owner_co->save_stack.ptr, owner_co->save_stack.sz);
+                owner_co->save_stack.sz = owner_co->save_stack.valid_sz + (owner_co->save_stack.valid_sz >> 2);
+                owner_co->save_stack.ptr = save_stack_alloc(&owner_co->save_stack.sz);
                 assert(owner_co->save_stack.ptr);
             }
 
@@ -461,21 +456,11 @@ aco_attr_no_asan void aco_share_spill(aco_t *aco) {
 
     aco->save_stack.valid_sz = (uintptr_t) (aco->share_stack->align_retptr) - (uintptr_t) (aco->reg[ACO_REG_IDX_SP]);
 
-    // realloc stack
+    // realloc stack, save_stack 由 gc 管理, 不能通过 free 释放
     if (aco->save_stack.sz < aco->save_stack.valid_sz) {
-        free(aco->save_stack.ptr);
-        aco->save_stack.ptr = NULL;
-
-        while (true) {
-            // <<1 equals *2
-            aco->save_stack.sz = aco->save_stack.sz << 1;
-            assert(aco->save_stack.sz > 0);
-            if (aco->save_stack.sz >= aco->save_stack.valid_sz) {
-                break;
-            }
-        }
-
-        aco->save_stack.ptr = rti_gc_malloc(aco->save_stack.sz, NULL);
+        save_stack_release(aco->save_stack.ptr, aco->save_stack.sz);
+        aco->save_stack.sz = aco->save_stack.valid_sz + (aco->save_stack.valid_sz >> 2);
+        aco->save_stack.ptr = save_stack_alloc(&aco->save_stack.sz);
         assert(aco->save_stack.ptr);
     }
 
@@ -665,7 +665,7 @@ void mheap_grow(uint64_t pages_count) {
  * @return
  */
 static mspan_t *mheap_alloc_span(uint64_t pages_count, uint8_t spanclass) {
-    mutex_lock(&memory->locker);
+    futex_lock(&memory->locker);
     assert(pages_count > 0);
     // - 从 page_alloc 中查看有没有连续 pages_count 空闲的页，如果有就直接分配
     // 因为有垃圾回收的存在，所以 page_alloc 中的历史上的某些部分存在空闲且连续的 pages
@@ -692,7 +692,7 @@ static mspan_t *mheap_alloc_span(uint64_t pages_count, uint8_t spanclass) {
     }
 
 
-    mutex_unlock(&memory->locker);
+    futex_unlock(&memory->locker);
     DEBUGF("[mheap_alloc_span] success, span=%p, base=%p, spc=%d, obj_count=%lu, alloc_count=%lu", span,
            (void *) span->base,
            span->spanclass, span->obj_count, span->alloc_count);
@@ -1138,7 +1138,7 @@ void memory_init() {
     memory = NEW(memory_t);
     memory->sweepgen = 0;
     memory->gc_count = 0;
-    mutex_init(&memory->locker, false);
+    futex_locker_init(&memory->locker);
 
     // 初始化 gc 参数
     allocated_bytes = 0;
@@ -1287,7 +1287,7 @@ void *rti_gc_malloc(uint64_t size, rtype_t *rtype) {
  * @return
  */
 mspan_t *mspan_new(uint64_t base, uint64_t pages_count, uint8_t spanclass) {
-    assert(memory->locker.locker_count > memory->locker.unlocker_count);
+    assert(futex_is_locked(&memory->locker));
     mspan_t *span = fixalloc_alloc(&memory->mheap->spanalloc);
 
     span->base = base;
@@ -1329,7 +1329,7 @@ uint64_t runtime_malloc_bytes() {
 }
 
 void runtime_eval_gc() {
-    mutex_lock(&gc_stage_locker);
+    futex_lock(&gc_stage_locker);
 
     if (gc_stage != GC_STAGE_OFF) {
         DEBUGF("[runtime_eval_gc] gc is running = %d, skip", gc_stage);
@@ -1346,15 +1346,14 @@ void runtime_eval_gc() {
     }
 
     gc_stage = GC_STAGE_START;
-    uv_thread_t runtime_gc_thread;
-    uv_thread_create(&runtime_gc_thread, runtime_gc, NULL);
+    gc_controller_wake();
 
 EXIT:
-    mutex_unlock(&gc_stage_locker);
+    futex_unlock(&gc_stage_locker);
 }
 
 void runtime_force_gc() {
-    if (mutex_trylock(&gc_stage_locker) != 0) {
+    if (!futex_trylock(&gc_stage_locker)) {
         return;
     }
 
@@ -1366,11 +1365,10 @@ void runtime_force_gc() {
     }
 
     gc_stage = GC_STAGE_START;
-    uv_thread_t runtime_gc_thread;
-    uv_thread_create(&runtime_gc_thread, runtime_gc, NULL);
+    gc_controller_wake();
 
 EXIT:
-    mutex_unlock(&gc_stage_locker);
+    futex_unlock(&gc_stage_locker);
     DEBUGF("[runtime_force_gc] end");
 }
 
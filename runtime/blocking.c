@@ -0,0 +1,136 @@
+#include "blocking.h"
+
+#include "processor.h"
+
+static mutex_t blocking_locker;
+static n_processor_t *blocking_workers[PROCESSOR_MAX];
+static int64_t blocking_count = 0; // 已经创建的工作 processor 数量
+static coroutine_t *blocking_pending = NULL; // 等待工作 processor 的 coroutine(co->next 链接)
+
+void blocking_init() {
+    mutex_init(&blocking_locker, false);
+    blocking_count = 0;
+    blocking_pending = NULL;
+}
+
+/**
+ * 调用方需要持有 blocking_locker
+ * @return gc 期间或者达到上限时返回 NULL
+ */
+static n_processor_t *blocking_worker_new() {
+    if (blocking_count >= sched_tunables.blocking_max || cpu_count + blocking_count >= PROCESSOR_MAX) {
+        return NULL;
+    }
+
+    // 持有 gc_stage_locker 并且 gc_stage == GC_STAGE_OFF 时 gc 无法开始, 新的 processor 可以安全的加入 processor_list
+    futex_lock(&gc_stage_locker);
+    if (gc_stage != GC_STAGE_OFF) {
+        futex_unlock(&gc_stage_locker);
+        return NULL;
+    }
+
+    n_processor_t *p = processor_new(cpu_count + (int) blocking_count);
+    p->blocking = true;
+    p->blocking_load = 0;
+    processor_spawn(p);
+    futex_unlock(&gc_stage_locker);
+
+    blocking_workers[blocking_count++] = p;
+    DEBUGF("[runtime.blocking_worker_new] new blocking worker p_index=%d, count=%ld", p->index, blocking_count);
+    return p;
+}
+
+/**
+ * 调用方需要持有 blocking_locker
+ */
+static n_processor_t *blocking_select() {
+    n_processor_t *select_p = NULL;
+    for (int64_t i = 0; i < blocking_count; ++i) {
+        n_processor_t *p = blocking_workers[i];
+        int64_t load = atomic_load(&p->blocking_load);
+        if (load == 0) {
+            return p;
+        }
+
+        if (!select_p || load < atomic_load(&select_p->blocking_load)) {
+            select_p = p;
+        }
+    }
+
+    n_processor_t *p = blocking_worker_new();
+    if (p) {
+        return p;
+    }
+
+    return select_p;
+}
+
+static void blocking_push(n_processor_t *p, coroutine_t *co) {
+    atomic_fetch_add(&p->blocking_load, 1);
+    rt_linked_fixalloc_push(&p->co_list, co);
+    runq_put(p, co);
+
+    DEBUGF("[runtime.blocking_push] co=%p to blocking p_index=%d, load=%ld", co, p->index, p->blocking_load);
+}
+
+void blocking_dispatch(coroutine_t *co) {
+    mutex_lock(&blocking_locker);
+    n_processor_t *p = blocking_select();
+    if (!p) {
+        co->next = blocking_pending;
+        blocking_pending = co;
+        mutex_unlock(&blocking_locker);
+        DEBUGF("[runtime.blocking_dispatch] no blocking worker available, co=%p pending", co);
+        return;
+    }
+
+    // 在 blocking_locker 中增加 load, 避免并发 dispatch 选择同一个空闲的工作 processor
+    blocking_push(p, co);
+    mutex_unlock(&blocking_locker);
+}
+
+void blocking_done(n_processor_t *p) {
+    assert(p->blocking);
+    atomic_fetch_sub(&p->blocking_load, 1);
+}
+
+void blocking_sysmon() {
+    // 无锁读取仅用于快速判断
+    if (!blocking_pending) {
+        return;
+    }
+
+    mutex_lock(&blocking_locker);
+    while (blocking_pending) {
+        n_processor_t *p = blocking_select();
+        if (!p) {
+            break;
+        }
+
+        coroutine_t *co = blocking_pending;
+        blocking_pending = co->next;
+        co->next = NULL;
+        blocking_push(p, co);
+    }
+    mutex_unlock(&blocking_locker);
+}
+
+void blocking_scan_pending(rt_linked_fixalloc_t *worklist) {
+    mutex_lock(&blocking_locker);
+    for (coroutine_t *co = blocking_pending; co; co = co->next) {
+        DEBUGF("[runtime.blocking_scan_pending] co=%p, fn=%p, arg=%p, future=%p", co, co->fn, co->arg, co->future);
+
+        if (span_of((addr_t) co->fn)) {
+            rt_linked_fixalloc_push(worklist, co->fn);
+        }
+
+        if (span_of((addr_t) co->arg)) {
+            rt_linked_fixalloc_push(worklist, co->arg);
+        }
+
+        if (co->future && span_of((addr_t) co->future)) {
+            rt_linked_fixalloc_push(worklist, co->future);
+        }
+    }
+    mutex_unlock(&blocking_locker);
+}
@@ -0,0 +1,37 @@
+#ifndef NATURE_BLOCKING_H
+#define NATURE_BLOCKING_H
+
+#include "runtime.h"
+
+/**
+ * run_blocking 工作线程池。
+ * 每个工作线程都是一个 blocking processor(index >= cpu_count), 拥有独立的 uv_loop/mcache, 与普通 processor 一样参与 stw 与 gc_work,
+ * 但不参与 dispatch/窃取，仅运行 CO_FLAG_BLOCKING coroutine。工作线程按需创建，数量上限为 sched_tunables.blocking_max,
+ * 达到上限后新的任务排队到负载最低的工作线程中。
+ */
+
+void blocking_init();
+
+/**
+ * 优先选择空闲的工作 processor, 没有空闲时创建新的工作 processor
+ * gc 期间无法创建工作 processor, 此时如果还没有任何工作 processor 则暂存到 pending 中，由 sysmon 重新 dispatch
+ */
+void blocking_dispatch(coroutine_t *co);
+
+/**
+ * blocking coroutine 退出时在工作 processor 中调用
+ */
+void blocking_done(n_processor_t *p);
+
+/**
+ * sysmon 中定期调用，处理 pending 中的 coroutine
+ */
+void blocking_sysmon();
+
+/**
+ * in stop the world, pending 中的 coroutine 不在任何 co_list 中，gc_work 无法扫描到，
+ * 需要将其 fn/arg/future 添加到 worklist 中
+ */
+void blocking_scan_pending(rt_linked_fixalloc_t *worklist);
+
+#endif // NATURE_BLOCKING_H
@@ -0,0 +1,178 @@
+#include "blockprof.h"
+
+#include <stdio.h>
+
+#include "processor.h"
+#include "runtime/nutils/nutils.h"
+
+ATOMIC int64_t blockprof_rate = 0;
+
+static blockprof_entry_t *blockprof_buckets[BLOCKPROF_BUCKET_COUNT];
+static int64_t blockprof_entry_count = 0;
+static mutex_t blockprof_locker;
+
+static uint64_t blockprof_hash(int64_t reason, addr_t *pcs, int64_t depth) {
+    uint64_t hash = 14695981039346656037ULL ^ (uint64_t) reason;
+    for (int i = 0; i < depth; ++i) {
+        hash = (hash ^ pcs[i]) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+/**
+ * 基于 frame pointer 回溯当前 coroutine 的调用栈, 包含 runtime 中的 c 函数帧, dump 时再过滤
+ * coroutine 运行在 share stack 上, 所以 fp 必须单调增长且不能超过 share stack 的栈底
+ */
+static int64_t blockprof_unwind(coroutine_t *co, addr_t *pcs) {
+    addr_t fp = (addr_t) __builtin_frame_address(0);
+    addr_t top = (addr_t) co->aco.share_stack->align_retptr;
+    int64_t depth = 0;
+
+    while (depth < BLOCKPROF_MAX_DEPTH && fp > 0 && fp < top) {
+#ifdef __RISCV64
+        // riscv 中 fp 指向调用前的 sp, ra 与 prev fp 依次保存在 fp 下方
+        addr_t ret_addr = fetch_addr_value(fp - POINTER_SIZE);
+        addr_t prev_fp = fetch_addr_value(fp - POINTER_SIZE - POINTER_SIZE);
+#else
+        addr_t prev_fp = fetch_addr_value(fp);
+        addr_t ret_addr = fetch_addr_value(fp + POINTER_SIZE);
+#endif
+        if (ret_addr == 0) {
+            break;
+        }
+
+        pcs[depth++] = ret_addr;
+        if (prev_fp <= fp) {
+            break;
+        }
+        fp = prev_fp;
+    }
+
+    return depth;
+}
+
+void blockprof_record(uint64_t start, int64_t reason) {
+    int64_t rate = atomic_load_explicit(&blockprof_rate, memory_order_relaxed);
+    if (rate <= 0) {
+        return;
+    }
+
+    int64_t duration = (int64_t) (uv_hrtime() - start);
+    if (duration < rate && (rand() % rate) >= duration) {
+        return;
+    }
+
+    coroutine_t *co = coroutine_get();
+    if (!co || !co->aco.share_stack) {
+        return;
+    }
+
+    addr_t pcs[BLOCKPROF_MAX_DEPTH];
+    int64_t depth = blockprof_unwind(co, pcs);
+    uint64_t hash = blockprof_hash(reason, pcs, depth);
+
+    mutex_lock(&blockprof_locker);
+    blockprof_entry_t **bucket = &blockprof_buckets[hash & (BLOCKPROF_BUCKET_COUNT - 1)];
+    blockprof_entry_t *entry = *bucket;
+    while (entry) {
+        if (entry->hash == hash && entry->reason == reason && entry->depth == depth &&
+            memcmp(entry->pcs, pcs, sizeof(addr_t) * depth) == 0) {
+            break;
+        }
+        entry = entry->next;
+    }
+
+    if (!entry) {
+        entry = mallocz(sizeof(blockprof_entry_t));
+        entry->reason = reason;
+        entry->depth = depth;
+        memcpy(entry->pcs, pcs, sizeof(addr_t) * depth);
+        entry->hash = hash;
+        entry->next = *bucket;
+        *bucket = entry;
+        blockprof_entry_count++;
+    }
+
+    entry->count += 1;
+    entry->total_ns += duration;
+    mutex_unlock(&blockprof_locker);
+
+    DEBUGF("[runtime.blockprof_record] co=%p, reason=%ld, duration=%ld, depth=%ld", co, reason, duration, depth);
+}
+
+void rt_block_profile_rate(int64_t rate) {
+    if (rate < 0) {
+        rate = 0;
+    }
+
+    atomic_store_explicit(&blockprof_rate, rate, memory_order_relaxed);
+    DEBUGF("[runtime.rt_block_profile_rate] rate=%ld", rate);
+}
+
+static int blockprof_entry_compare(const void *a, const void *b) {
+    int64_t a_ns = (*(blockprof_entry_t **) a)->total_ns;
+    int64_t b_ns = (*(blockprof_entry_t **) b)->total_ns;
+    return a_ns < b_ns ? 1 : (a_ns > b_ns ? -1 : 0);
+}
+
+/**
+ * 与 go 的 legacy contention profile 格式一致, 时间单位为 ns(cycles/second=1e9)
+ * 以 # 开头的行会被 pprof 忽略, 用于直接阅读
+ */
+void rt_block_profile_dump(n_string_t *path) {
+    char *path_str = rt_string_ref(path);
+    FILE *f = fopen(path_str, "w");
+    if (!f) {
+        rti_throw(tlsprintf("open block profile file %s failed: %s", path_str, strerror(errno)), false);
+        return;
+    }
+
+    mutex_lock(&blockprof_locker);
+    blockprof_entry_t **entries = mallocz(sizeof(blockprof_entry_t *) * (blockprof_entry_count + 1));
+    int64_t count = 0;
+    for (int i = 0; i < BLOCKPROF_BUCKET_COUNT; ++i) {
+        for (blockprof_entry_t *entry = blockprof_buckets[i]; entry; entry = entry->next) {
+            entries[count++] = entry;
+        }
+    }
+    qsort(entries, count, sizeof(blockprof_entry_t *), blockprof_entry_compare);
+
+    fprintf(f, "--- contention:\n");
+    fprintf(f, "cycles/second=1000000000\n");
+    fprintf(f, "sampling period=%ld\n", atomic_load(&blockprof_rate));
+    for (int64_t i = 0; i < count; ++i) {
+        blockprof_entry_t *entry = entries[i];
+        fprintf(f, "%ld %ld @", entry->total_ns, entry->count);
+        for (int j = 0; j < entry->depth; ++j) {
+            fprintf(f, " 0x%lx", entry->pcs[j]);
+        }
+        fprintf(f, "\n");
+
+        fprintf(f, "#\treason: %s\n", trace_reason_name(entry->reason));
+        for (int j = 0; j < entry->depth; ++j) {
+            fndef_t *fn = fndef_lookup(entry->pcs[j]);
+            if (!fn) {
+                continue;
+            }
+
+            fprintf(f, "#\t0x%lx\t%s\t%s:%ld\n", entry->pcs[j], STRTABLE(fn->name_offset),
+                    STRTABLE(fn->relpath_offset), fn->line);
+        }
+    }
+    mutex_unlock(&blockprof_locker);
+
+    free(entries);
+    fclose(f);
+    DEBUGF("[runtime.rt_block_profile_dump] write %ld entries to %s", count, path_str);
+}
+
+void blockprof_init() {
+    mutex_init(&blockprof_locker, false);
+
+    char *rate = getenv(BLOCKPROF_RATE_ENV);
+    if (!rate || rate[0] == '\0') {
+        return;
+    }
+
+    rt_block_profile_rate(atoll(rate));
+}
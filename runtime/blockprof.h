@@ -0,0 +1,72 @@
+#ifndef NATURE_BLOCKPROF_H
+#define NATURE_BLOCKPROF_H
+
+#include <include/uv.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "runtime.h"
+
+#define BLOCKPROF_RATE_ENV "NATURE_BLOCKPROF_RATE" // 采样率, 设置后从启动开始记录阻塞事件
+#define BLOCKPROF_MAX_DEPTH 32 // 单个事件记录的栈帧数量上限
+#define BLOCKPROF_BUCKET_COUNT 1024 // 聚合表的 bucket 数量, 必须是 2 的幂
+
+/**
+ * 按照 (reason, 调用栈) 聚合的阻塞事件
+ */
+typedef struct blockprof_entry_t {
+    int64_t reason; // trace_reason_t
+    int64_t depth;
+    addr_t pcs[BLOCKPROF_MAX_DEPTH]; // 阻塞点的返回地址, 从内层到外层
+    int64_t count;
+    int64_t total_ns;
+    uint64_t hash;
+    struct blockprof_entry_t *next;
+} blockprof_entry_t;
+
+// 采样率, 单位 ns, 0 表示关闭
+// 阻塞时间 >= rate 的事件全部记录, 小于 rate 的事件以 duration/rate 的概率记录
+extern ATOMIC int64_t blockprof_rate;
+
+void blockprof_record(uint64_t start, int64_t reason);
+
+/**
+ * 在 coroutine 进入阻塞前调用, 未开启时仅有一次 atomic load
+ * @return 阻塞开始时间, 未开启时返回 0
+ */
+static inline uint64_t blockprof_start() {
+    if (__builtin_expect(atomic_load_explicit(&blockprof_rate, memory_order_relaxed) == 0, 1)) {
+        return 0;
+    }
+
+    return uv_hrtime();
+}
+
+/**
+ * 在 coroutine 被唤醒后调用, start 为 blockprof_start 的返回值
+ */
+static inline void blockprof_end(uint64_t start, int64_t reason) {
+    if (__builtin_expect(start == 0, 1)) {
+        return;
+    }
+
+    blockprof_record(start, reason);
+}
+
+/**
+ * 读取 NATURE_BLOCKPROF_RATE 环境变量
+ */
+void blockprof_init();
+
+/**
+ * 设置采样率, rate <= 0 时关闭, 已经聚合的数据不会被清空
+ */
+void rt_block_profile_rate(int64_t rate);
+
+/**
+ * 将聚合数据以 pprof 可以读取的 legacy contention 文本格式写入到 path 中
+ */
+void rt_block_profile_dump(n_string_t *path);
+
+#endif // NATURE_BLOCKPROF_H
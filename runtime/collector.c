@@ -1,7 +1,47 @@
+#include <stdatomic.h>
+
 #include "fixalloc.h"
 #include "gcbits.h"
 #include "memory.h"
 #include "processor.h"
+#include "blocking.h"
+#include "rt_pool.h"
+
+static pthread_mutex_t gc_controller_locker;
+static pthread_cond_t gc_controller_cond; // 唤醒 gc_controller
+static pthread_cond_t gc_mark_worker_cond; // 唤醒 gc_mark_worker
+static bool gc_controller_pending;
+static uint64_t gc_mark_worker_epoch; // 每一轮 mark 递增一次
+static int gc_mark_worker_count;
+static ATOMIC int64_t gc_mark_worker_busy; // 正在处理 global worklist 的 mark worker 数量
+static pthread_mutex_t gc_mark_locker;
+static pthread_cond_t gc_mark_work_cond; // global worklist 有新的 grey 对象或 mark 阶段结束时唤醒空闲的 mark worker
+static pthread_cond_t gc_mark_idle_cond; // mark 阶段结束后 busy 归零时唤醒 gc_mark_done
+static ATOMIC int64_t gc_mark_worker_idle; // 阻塞在 gc_mark_work_cond 上的 mark worker 数量
+
+/**
+ * 仅在存在空闲 mark worker 时才加锁唤醒，避免 write barrier 路径上的额外开销
+ * 与 gc_mark_worker_park 构成 dekker 模式: 一方先写 worklist 再读 idle, 另一方先写 idle 再读 worklist
+ */
+static void gc_mark_worker_notify() {
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load(&gc_mark_worker_idle) == 0) {
+        return;
+    }
+
+    pthread_mutex_lock(&gc_mark_locker);
+    pthread_cond_signal(&gc_mark_work_cond);
+    pthread_mutex_unlock(&gc_mark_locker);
+}
+
+/**
+ * gc_stage 离开 GC_STAGE_MARK 后调用，唤醒阻塞在 gc_mark_worker_park 中的 mark worker
+ */
+static void gc_mark_workers_stop() {
+    pthread_mutex_lock(&gc_mark_locker);
+    pthread_cond_broadcast(&gc_mark_work_cond);
+    pthread_mutex_unlock(&gc_mark_locker);
+}
 
 static void insert_gc_worklist(rt_linked_fixalloc_t *gc_worklist, void *ptr) {
     assert(span_of((addr_t) ptr) && "ptr not found in active span");
@@ -12,6 +52,10 @@ static void insert_gc_worklist(rt_linked_fixalloc_t *gc_worklist, void *ptr) {
         DEBUGF("[insert_gc_worklist] global worklist, p=%p, ptr=%p", gc_worklist, ptr);
     }
     rt_linked_fixalloc_push(gc_worklist, ptr);
+
+    if (gc_worklist == &global_gc_worklist) {
+        gc_mark_worker_notify();
+    }
 }
 
 /**
@@ -89,19 +133,13 @@ fndef_t *find_fn(addr_t addr, n_processor_t *p) {
         return fn;
     }
 
-    for (int i = 0; i < rt_fndef_count; ++i) {
-        fn = &rt_fndef_ptr[i];
-        assert(fn);
-
-        if (fn->base <= addr && addr < (fn->base + fn->size)) {
-            // put 增加 lock
-            sc_map_put_64v(&p->caller_cache, addr, fn);
-
-            return fn;
-        }
+    fn = fndef_lookup(addr);
+    if (fn) {
+        // put 增加 lock
+        sc_map_put_64v(&p->caller_cache, addr, fn);
     }
 
-    return NULL;
+    return fn;
 }
 
 /**
@@ -250,7 +288,7 @@ static bool sweep_span(mcentral_t *central, mspan_t *span) {
  */
 void mcentral_sweep(mheap_t *mheap) {
     RDEBUGF("[mcentral_sweep] start");
-    mutex_lock(&memory->locker);
+    futex_lock(&memory->locker);
 
     mcentral_t *centrals = mheap->centrals;
     for (int i = 0; i < SPANCLASS_COUNT; ++i) {
@@ -308,11 +346,23 @@ void mcentral_sweep(mheap_t *mheap) {
         }
     }
 
-    mutex_unlock(&memory->locker);
+    futex_unlock(&memory->locker);
     RDEBUGF("[mcentral_sweep] start");
 }
 
 
+/**
+ * 异步抢占会将 c 函数返回到 nature fn 的返回地址替换为 assist_preempt_return, 扫描时需要还原
+ */
+static inline addr_t scan_ret_addr(coroutine_t *co, addr_t ret_addr) {
+#ifdef __AMD64
+    if (ret_addr == (addr_t) assist_preempt_return) {
+        return co->preempt_ret_addr;
+    }
+#endif
+    return ret_addr;
+}
+
 /**
  * save_stack 中保存着 coroutine 栈数组，其中 stack->ptr 指向了原始栈的栈顶
  * 整个 ptr 申请的空间是 sz, 实际占用的空间是 valid_sz，valid_sz 是经过 align 的空间
@@ -361,6 +411,13 @@ static void scan_stack(n_processor_t *p, coroutine_t *co) {
     aco_save_stack_t save_stack = co->aco.save_stack;
     uint64_t size = 0;
     size = save_stack.valid_sz;
+
+    // 独立栈不会溢出到 save_stack 中, 直接扫描原始栈, 此时 stack_top_ptr + bp_offset 就是原始栈地址
+    if (co->own_stack) {
+        assert(co->aco.share_stack->owner == &co->aco);
+        stack_top_ptr = sp_value;
+        size = (addr_t) co->aco.share_stack->align_retptr - sp_value;
+    }
     assert(size > 0);
 
     DEBUGF("[runtime_gc.scan_stack] co=%p will scan stack, valid_size=%lu", co, size);
@@ -414,12 +471,12 @@ static void scan_stack(n_processor_t *p, coroutine_t *co) {
         // bp value 和 ret_addr 不是那么同步
         share_stack_frame_bp = fetch_addr_value(stack_top_ptr + bp_offset - POINTER_SIZE - POINTER_SIZE);
         // save_stack.ptr 指向栈顶, new ret_addr, ret_addr 总是在 prev_bp 的前一个位置(+pointer_size)
-        ret_addr = fetch_addr_value(stack_top_ptr + bp_offset - POINTER_SIZE);
+        ret_addr = scan_ret_addr(co, fetch_addr_value(stack_top_ptr + bp_offset - POINTER_SIZE));
 #else
         // bp value 和 ret_addr 不是那么同步
         share_stack_frame_bp = fetch_addr_value(stack_top_ptr + bp_offset);
         // save_stack.ptr 指向栈顶, new ret_addr, ret_addr 总是在 prev_bp 的前一个位置(+pointer_size)
-        ret_addr = fetch_addr_value(stack_top_ptr + bp_offset + POINTER_SIZE);
+        ret_addr = scan_ret_addr(co, fetch_addr_value(stack_top_ptr + bp_offset + POINTER_SIZE));
 #endif
     }
 
@@ -458,10 +515,10 @@ static void scan_stack(n_processor_t *p, coroutine_t *co) {
         // 只有 nature 代码通过 safepoint 才能调用到 assist_preempt_yield
 #ifdef __RISCV64
         share_stack_frame_bp = fetch_addr_value(stack_top_ptr + bp_offset - POINTER_SIZE - POINTER_SIZE);
-        ret_addr = fetch_addr_value(stack_top_ptr + bp_offset - POINTER_SIZE);
+        ret_addr = scan_ret_addr(co, fetch_addr_value(stack_top_ptr + bp_offset - POINTER_SIZE));
 #else
         share_stack_frame_bp = fetch_addr_value(stack_top_ptr + bp_offset);
-        ret_addr = fetch_addr_value(stack_top_ptr + bp_offset + POINTER_SIZE);
+        ret_addr = scan_ret_addr(co, fetch_addr_value(stack_top_ptr + bp_offset + POINTER_SIZE));
 #endif
         found = true;
     }
@@ -520,7 +577,7 @@ static void scan_stack(n_processor_t *p, coroutine_t *co) {
 
         // 重新提取 ret_addr 和 share_stack_frame_bp
         share_stack_frame_bp = fetch_addr_value(stack_top_ptr + bp_offset);
-        ret_addr = fetch_addr_value(stack_top_ptr + bp_offset + POINTER_SIZE);
+        ret_addr = scan_ret_addr(co, fetch_addr_value(stack_top_ptr + bp_offset + POINTER_SIZE));
     }
 
     DEBUGF("[runtime_gc.scan_stack] completed, p_index=%d, co=%p", p->index, co);
@@ -705,6 +762,19 @@ static void gc_work() {
             insert_gc_worklist(&share_p->gc_worklist, wait_co->arg);
         }
 
+        // go 返回的 future 可能被直接丢弃，co 退出前仍然会写入 future->result/error/co, 所以需要 mark
+        if (wait_co->future && span_of((addr_t) wait_co->future)) {
+            DEBUGF("[runtime_gc.gc_work] co=%p future=%p in heap and span, need gc mark", wait_co, wait_co->future);
+            insert_gc_worklist(&share_p->gc_worklist, wait_co->future);
+        }
+
+        // 已经从 chan waitq 中 pop 但还未 resume 的 coroutine, 其 linkco 仅被 c 栈帧引用，scan_stack 不会扫描 c 栈帧
+        // 在 runq 中等待期间如果发生 gc, linkco 会被错误清理，所以需要通过 co->waiting 进行 mark(select 通过 waitlink 链接)
+        if (wait_co->waiting && span_of((addr_t) wait_co->waiting)) {
+            DEBUGF("[runtime_gc.gc_work] co=%p waiting=%p in heap and span, need gc mark", wait_co, wait_co->waiting);
+            insert_gc_worklist(&share_p->gc_worklist, wait_co->waiting);
+        }
+
         // 只有第一次 resume 时才会初始化 co, 申请堆栈，并且绑定对应的 p
         if (!wait_co->aco.inited) {
             DEBUGF("[runtime_gc.gc_work] co=%p, fn=%p not init, will skip", wait_co, wait_co->fn);
@@ -729,6 +799,13 @@ static void gc_work() {
         wait_co->gc_black = memory->gc_count;
     }
 
+    // save_stack_cache 中的 save_stack 没有被任何 coroutine 引用，需要单独 mark (gc_work 运行在 share_p 中，可以直接访问)
+    for (int i = 0; i < SAVE_STACK_CLASS_COUNT; ++i) {
+        for (void *ptr = share_p->save_stack_cache[i]; ptr; ptr = *(void **) ptr) {
+            insert_gc_worklist(&share_p->gc_worklist, ptr);
+        }
+    }
+
     DEBUGF("[runtime_gc.gc_work] p_index=%d, share processor scan stack completed, will yield", share_p->index);
 
     co_yield_runnable(share_p, gc_co);
@@ -750,7 +827,7 @@ static void inject_gc_work_coroutine() {
         coroutine_t *gc_co = rt_coroutine_new((void *) gc_work, FLAG(CO_FLAG_RTFN), 0, NULL);
 
         rt_linked_fixalloc_push(&p->co_list, gc_co);
-        rt_linked_fixalloc_push(&p->runnable_list, gc_co);
+        runq_put(p, gc_co);
     }
 
     RDEBUGF("[runtime_gc.inject_gc_work_coroutine] inject gc work coroutine completed");
@@ -781,6 +858,8 @@ static void scan_pool() {
             rt_linked_fixalloc_push(&p->gc_worklist, linkco);
         }
     }
+
+    pool_gc_scan(&processor_list->gc_worklist);
 }
 
 /**
@@ -849,15 +928,32 @@ static void scan_global() {
 
 /**
  * 处理剩余的 global gc worklist, 当前已经在 STW 了
+ * mark worker 可能还持有从 global worklist 中 pop 出来的 ptr, 需要等待其退出后才能确认 worklist 为空
  */
 static void gc_mark_done() {
     DEBUGF("[runtime_gc.gc_mark_done] start");
 
+    atomic_thread_fence(memory_order_seq_cst);
+
+    // gc_stage 已经离开 GC_STAGE_MARK, 唤醒空闲的 mark worker 退出
+    gc_mark_workers_stop();
+
     // - handle work list
     while (true) {
         addr_t addr = (addr_t) global_gc_worklist_pop();
         if (!addr) {
-            break;
+            // 等待持有 ptr 的 mark worker 处理完成, 其处理过程中可能继续向 global worklist 推送 ptr
+            pthread_mutex_lock(&gc_mark_locker);
+            while (atomic_load(&gc_mark_worker_busy) > 0 && global_gc_worklist.count == 0) {
+                pthread_cond_wait(&gc_mark_idle_cond, &gc_mark_locker);
+            }
+            bool done = atomic_load(&gc_mark_worker_busy) == 0 && global_gc_worklist.count == 0;
+            pthread_mutex_unlock(&gc_mark_locker);
+
+            if (done) {
+                break;
+            }
+            continue;
         }
         RDEBUGF("[runtime_gc.gc_mark_done] item addr=%p", (void *) addr);
         handle_gc_ptr(NULL, addr);
@@ -867,7 +963,158 @@ static void gc_mark_done() {
 }
 
 /**
- * 再单独的线程中执行
+ * busy 归零且 mark 阶段已经结束时唤醒 gc_mark_done, mark 阶段中 busy 频繁归零，此时不需要加锁唤醒
+ */
+static void gc_mark_worker_leave() {
+    if (atomic_fetch_sub(&gc_mark_worker_busy, 1) != 1) {
+        return;
+    }
+
+    atomic_thread_fence(memory_order_seq_cst);
+    if (gc_stage == GC_STAGE_MARK) {
+        return;
+    }
+
+    pthread_mutex_lock(&gc_mark_locker);
+    pthread_cond_broadcast(&gc_mark_idle_cond);
+    pthread_mutex_unlock(&gc_mark_locker);
+}
+
+/**
+ * global worklist 为空时阻塞等待，直到有新的 grey 对象推送或者 mark 阶段结束
+ */
+static void gc_mark_worker_park() {
+    pthread_mutex_lock(&gc_mark_locker);
+    atomic_fetch_add(&gc_mark_worker_idle, 1);
+    atomic_thread_fence(memory_order_seq_cst);
+
+    while (gc_stage == GC_STAGE_MARK && global_gc_worklist.count == 0) {
+        pthread_cond_wait(&gc_mark_work_cond, &gc_mark_locker);
+    }
+
+    atomic_fetch_sub(&gc_mark_worker_idle, 1);
+    pthread_mutex_unlock(&gc_mark_locker);
+}
+
+/**
+ * mark 阶段由独立的 mark worker 线程辅助处理 global_gc_worklist, 避免 global worklist 全部堆积到 STW 期间的 gc_mark_done
+ * 与 gc_work 协程不同，mark worker 不占用 processor 的执行时间
+ * @stack system
+ */
+static void gc_mark_worker_drain() {
+    int handle_count = 0;
+    while (true) {
+        atomic_fetch_add(&gc_mark_worker_busy, 1);
+        atomic_thread_fence(memory_order_seq_cst);
+
+        // gc_mark_done 会在修改 gc_stage 后等待 busy 归零, 所以必须先增加 busy 再检测 gc_stage
+        if (gc_stage != GC_STAGE_MARK) {
+            gc_mark_worker_leave();
+            break;
+        }
+
+        addr_t addr = (addr_t) global_gc_worklist_pop();
+        if (addr) {
+            handle_gc_ptr(NULL, addr);
+            handle_count++;
+        }
+
+        gc_mark_worker_leave();
+
+        if (!addr) {
+            gc_mark_worker_park();
+        }
+    }
+
+    DEBUGF("[runtime_gc.gc_mark_worker_drain] gc_count=%lu, handle_count=%d", memory->gc_count, handle_count);
+}
+
+static void gc_mark_worker(void *arg) {
+    uint64_t seen_epoch = 0;
+    while (true) {
+        pthread_mutex_lock(&gc_controller_locker);
+        while (gc_mark_worker_epoch == seen_epoch) {
+            pthread_cond_wait(&gc_mark_worker_cond, &gc_controller_locker);
+        }
+        seen_epoch = gc_mark_worker_epoch;
+        pthread_mutex_unlock(&gc_controller_locker);
+
+        gc_mark_worker_drain();
+    }
+}
+
+static void gc_mark_workers_start() {
+    if (gc_mark_worker_count == 0) {
+        return;
+    }
+
+    pthread_mutex_lock(&gc_controller_locker);
+    gc_mark_worker_epoch += 1;
+    pthread_cond_broadcast(&gc_mark_worker_cond);
+    pthread_mutex_unlock(&gc_controller_locker);
+}
+
+/**
+ * 常驻的 gc 控制线程，由 runtime_eval_gc/runtime_force_gc 唤醒后执行一轮 runtime_gc
+ * @stack system
+ */
+static void gc_controller(void *arg) {
+    while (true) {
+        pthread_mutex_lock(&gc_controller_locker);
+        while (!gc_controller_pending) {
+            pthread_cond_wait(&gc_controller_cond, &gc_controller_locker);
+        }
+        gc_controller_pending = false;
+        pthread_mutex_unlock(&gc_controller_locker);
+
+        runtime_gc();
+    }
+}
+
+/**
+ * 调用方需要持有 gc_stage_locker 并且已经将 gc_stage 设置为 GC_STAGE_START
+ */
+void gc_controller_wake() {
+    pthread_mutex_lock(&gc_controller_locker);
+    gc_controller_pending = true;
+    pthread_cond_signal(&gc_controller_cond);
+    pthread_mutex_unlock(&gc_controller_locker);
+}
+
+/**
+ * 启动 gc 控制线程与 mark worker 线程, 需要在 cpu_count 初始化完成后调用
+ */
+void gc_controller_init() {
+    pthread_mutex_init(&gc_controller_locker, NULL);
+    pthread_cond_init(&gc_controller_cond, NULL);
+    pthread_cond_init(&gc_mark_worker_cond, NULL);
+    gc_controller_pending = false;
+    gc_mark_worker_epoch = 0;
+    gc_mark_worker_busy = 0;
+    pthread_mutex_init(&gc_mark_locker, NULL);
+    pthread_cond_init(&gc_mark_work_cond, NULL);
+    pthread_cond_init(&gc_mark_idle_cond, NULL);
+    gc_mark_worker_idle = 0;
+
+    // cpu 较少时 mark worker 会与 processor 争抢 cpu, 此时仅依赖 gc_work 协程
+    gc_mark_worker_count = cpu_count / GC_MARK_WORKER_FRACTION;
+
+    uv_thread_t thread_id;
+    if (uv_thread_create(&thread_id, gc_controller, NULL) != 0) {
+        assert(false && "gc controller thread create failed");
+    }
+
+    for (int i = 0; i < gc_mark_worker_count; ++i) {
+        if (uv_thread_create(&thread_id, gc_mark_worker, NULL) != 0) {
+            assert(false && "gc mark worker thread create failed");
+        }
+    }
+
+    DEBUGF("[gc_controller_init] gc controller started, mark_worker_count=%d", gc_mark_worker_count);
+}
+
+/**
+ * 在常驻的 gc_controller 线程中执行
  * @stack system
  */
 void runtime_gc() {
@@ -910,15 +1157,21 @@ void runtime_gc() {
 
     scan_pool();
 
+    blocking_scan_pending(&processor_list->gc_worklist);
+
     DEBUGF("[runtime_gc] gc work coroutine injected, will start the world");
     processor_all_start();
 
     // - gc stage: GC_MARK
     gc_stage = GC_STAGE_MARK;
     DEBUGF("[runtime_gc] gc stage: GC_MARK, the world start");
+    trace_event(TRACE_GC_MARK_BEGIN, 0, 0);
+
+    gc_mark_workers_start();
 
     // 等待所有的 processor 都 mark 完成
     wait_all_gc_work_finished();
+    trace_event(TRACE_GC_MARK_END, 0, 0);
 
     // STW 之后再更改 GC 阶段
     DEBUGF("[runtime_gc] wait all processor gc work completed, will stop the world and get solo stw locker");
@@ -927,6 +1180,7 @@ void runtime_gc() {
         DEBUGF("[runtime_gc] wait processor safe sweep timeout, will return")
         processor_all_start();
         gc_stage = GC_STAGE_OFF;
+        gc_mark_workers_stop();
         return;
     }
     DEBUGF("[runtime_gc] all processor safe");
@@ -943,6 +1197,7 @@ void runtime_gc() {
     // - gc stage: GC_SWEEP
     gc_stage = GC_STAGE_SWEEP;
     DEBUGF("[runtime_gc] gc stage: GC_SWEEP");
+    trace_event(TRACE_GC_SWEEP_BEGIN, 0, 0);
 
     // gc 清理 需要获取 memory_locker, 避免 wait_sysmon 中 processor_free 产生新的 uncache_span
     // 此时已经 stw 了，所以不需要使用 memory->locker
@@ -958,6 +1213,8 @@ void runtime_gc() {
     gcbits_arenas_epoch();
     DEBUGF("[runtime_gc] gcbits_arenas_epoch completed, will stop gc barrier");
 
+    trace_event(TRACE_GC_SWEEP_END, 0, 0);
+
     gc_barrier_stop();
     processor_all_start();
 
@@ -0,0 +1,116 @@
+#include "costack.h"
+
+#include <sys/mman.h>
+
+#include "processor.h"
+
+static mutex_t costack_locker;
+static costack_t *costack_free_list = NULL;
+static ATOMIC int64_t costack_free_count = 0;
+static int64_t costack_live_count = 0;
+
+// (fn_addr << 1) | deep, 直接映射，冲突时直接覆盖
+static ATOMIC uint64_t costack_profile[COSTACK_PROFILE_SIZE];
+
+void costack_init() {
+    mutex_init(&costack_locker, false);
+    costack_free_list = NULL;
+    costack_free_count = 0;
+    costack_live_count = 0;
+}
+
+/**
+ * 闭包 fn 是每次 go 时在堆中生成的 jit codes, 需要使用其对应的 fn_addr 作为统计 key
+ */
+static addr_t costack_profile_key(coroutine_t *co) {
+    addr_t fn = (addr_t) co->fn;
+    if (in_heap(fn)) {
+        return ((runtime_fn_t *) fn)->fn_addr;
+    }
+    return fn;
+}
+
+static inline uint64_t costack_profile_index(addr_t key) {
+    return (key ^ (key >> 12)) & (COSTACK_PROFILE_SIZE - 1);
+}
+
+bool costack_want(coroutine_t *co) {
+    if (co->main || (co->flag & FLAG(CO_FLAG_RTFN))) {
+        return false;
+    }
+
+    if (co->flag & FLAG(CO_FLAG_OWN_STACK)) {
+        return true;
+    }
+
+    addr_t key = costack_profile_key(co);
+    uint64_t value = atomic_load_explicit(&costack_profile[costack_profile_index(key)], memory_order_relaxed);
+    return (value >> 1) == key && (value & 1);
+}
+
+void costack_profile_update(coroutine_t *co) {
+    if (co->main || (co->flag & FLAG(CO_FLAG_RTFN))) {
+        return;
+    }
+
+    // 切换次数过少时拷贝开销不明显，不更新统计
+    if (co->switch_count < COSTACK_DEEP_SWITCHES) {
+        return;
+    }
+
+    addr_t key = costack_profile_key(co);
+    bool deep = co->stack_depth_max >= COSTACK_DEEP_DEPTH;
+    atomic_store_explicit(&costack_profile[costack_profile_index(key)], ((uint64_t) key << 1) | deep,
+                          memory_order_relaxed);
+
+    DEBUGF("[runtime.costack_profile_update] co=%p, fn_addr=%p, switch_count=%u, stack_depth_max=%lu, deep=%d", co,
+           (void *) key, co->switch_count, co->stack_depth_max, deep);
+}
+
+aco_share_stack_t *costack_acquire() {
+    mutex_lock(&costack_locker);
+    costack_t *costack = costack_free_list;
+    if (costack) {
+        costack_free_list = costack->next;
+        costack_free_count--;
+    } else if (costack_live_count >= COSTACK_MAX) {
+        mutex_unlock(&costack_locker);
+        return NULL;
+    }
+
+    costack_live_count++;
+    mutex_unlock(&costack_locker);
+
+    if (!costack) {
+        costack = mallocz(sizeof(costack_t));
+        aco_share_stack_init(&costack->stack, 0);
+        DEBUGF("[runtime.costack_acquire] new costack=%p, ptr=%p, sz=%zu", costack, costack->stack.ptr,
+               costack->stack.sz);
+    }
+
+    costack->next = NULL;
+    assert(costack->stack.owner == NULL);
+    return &costack->stack;
+}
+
+void costack_release(aco_share_stack_t *stack) {
+    costack_t *costack = (costack_t *) stack;
+    assert(stack->owner == NULL);
+
+    // 空闲栈过多时保留地址空间，仅归还物理内存(必须在放回 free list 之前完成)
+    // 栈顶所在的页中存储了 aco_funcp_protector_asm, 需要保留
+    if (atomic_load_explicit(&costack_free_count, memory_order_relaxed) >= COSTACK_CACHE_MAX) {
+        long pgsz = sysconf(_SC_PAGESIZE);
+        addr_t end = (addr_t) stack->align_retptr & ~((addr_t) pgsz - 1);
+        if (end > (addr_t) stack->ptr) {
+            madvise(stack->ptr, end - (addr_t) stack->ptr, MADV_DONTNEED);
+        }
+    }
+
+    mutex_lock(&costack_locker);
+    costack->next = costack_free_list;
+    costack_free_list = costack;
+    costack_free_count++;
+    costack_live_count--;
+    mutex_unlock(&costack_locker);
+}
@@ -0,0 +1,55 @@
+#ifndef NATURE_COSTACK_H
+#define NATURE_COSTACK_H
+
+#include "runtime.h"
+
+/**
+ * 默认所有 coroutine 共享 processor 的 share_stack, 切换时需要将栈拷贝到 save_stack 中。
+ * 栈较深并且频繁切换的 coroutine 使用独立的 mmap 栈(带 guard page, 物理内存按需分配)，
+ * 此时 share_stack->owner 永远是该 coroutine, aco_resume 不再产生栈拷贝。
+ */
+
+#define COSTACK_DEEP_DEPTH 16384 // yield 时栈深度超过 16KB 视为深栈
+#define COSTACK_DEEP_SWITCHES 8 // 生命周期内至少切换 8 次才值得使用独立栈
+#define COSTACK_MAX 4096 // 同时存活的独立栈上限, 超过后回退到 share_stack, 避免栈地址空间与 arena 冲突
+#define COSTACK_CACHE_MAX 64 // 空闲栈超过该数量后释放时会通过 madvise 归还物理内存
+#define COSTACK_PROFILE_SIZE 4096 // fn 栈深度统计表大小, 必须是 2 的幂
+
+typedef struct costack_t costack_t;
+
+struct costack_t {
+    aco_share_stack_t stack; // 必须是首个字段, 释放时通过 aco_share_stack_t 指针还原
+    costack_t *next;
+};
+
+void costack_init();
+
+/**
+ * 根据 co flag 与同一 fn 历史的栈深度判断是否使用独立栈
+ */
+bool costack_want(coroutine_t *co);
+
+/**
+ * 获取一个独立栈，超过 COSTACK_MAX 时返回 NULL
+ */
+aco_share_stack_t *costack_acquire();
+
+void costack_release(aco_share_stack_t *stack);
+
+/**
+ * coroutine 每次从 resume 中返回时记录栈深度
+ */
+static inline void costack_observe(coroutine_t *co) {
+    addr_t depth = (addr_t) co->aco.share_stack->align_retptr - (addr_t) co->aco.reg[ACO_REG_IDX_SP];
+    if (depth > co->stack_depth_max) {
+        co->stack_depth_max = depth;
+    }
+    co->switch_count += 1;
+}
+
+/**
+ * coroutine 退出时更新 fn 的栈深度统计，用于后续同一 fn 创建的 coroutine
+ */
+void costack_profile_update(coroutine_t *co);
+
+#endif // NATURE_COSTACK_H
@@ -0,0 +1,64 @@
+#include <sched.h>
+
+#include "runtime.h" // 包含 futex.h
+
+#ifdef __LINUX
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+void futex_wait(ATOMIC uint32_t *addr, uint32_t val) {
+    // 值不等于 val 时立即返回 EAGAIN, 被信号中断时返回 EINTR, 调用方需要循环检查
+    syscall(SYS_futex, addr, FUTEX_WAIT_PRIVATE, val, NULL, NULL, 0);
+}
+
+void futex_wake(ATOMIC uint32_t *addr, int count) {
+    syscall(SYS_futex, addr, FUTEX_WAKE_PRIVATE, count, NULL, NULL, 0);
+}
+#elif defined(__DARWIN)
+// libSystem 中的私有接口, libc++ 的 atomic wait 同样基于该接口实现
+#define UL_COMPARE_AND_WAIT 1
+#define ULF_NO_ERRNO 0x01000000
+
+extern int __ulock_wait(uint32_t operation, void *addr, uint64_t value, uint32_t timeout);
+
+extern int __ulock_wake(uint32_t operation, void *addr, uint64_t wake_value);
+
+void futex_wait(ATOMIC uint32_t *addr, uint32_t val) {
+    __ulock_wait(UL_COMPARE_AND_WAIT | ULF_NO_ERRNO, (void *) addr, val, 0);
+}
+
+void futex_wake(ATOMIC uint32_t *addr, int count) {
+    __ulock_wake(UL_COMPARE_AND_WAIT | ULF_NO_ERRNO, (void *) addr, 0);
+}
+#else
+void futex_wait(ATOMIC uint32_t *addr, uint32_t val) {
+    sched_yield();
+}
+
+void futex_wake(ATOMIC uint32_t *addr, int count) {
+}
+#endif
+
+void futex_lock_slow(futex_locker_t *l) {
+    // 持有锁的时间通常很短, 先进行有限次数的自旋, 每次失败后加倍 cpu_relax 的次数
+    int pause = 1;
+    for (int i = 0; i < FUTEX_SPIN_COUNT; ++i) {
+        if (atomic_load_explicit(&l->state, memory_order_relaxed) == 0 && futex_trylock(l)) {
+            return;
+        }
+
+        for (int j = 0; j < pause; ++j) {
+            cpu_relax();
+        }
+        if (pause < FUTEX_SPIN_PAUSE_MAX) {
+            pause <<= 1;
+        }
+    }
+
+    // 将 state 标记为 2(存在等待者), 交换前为 0 说明已经获取到锁
+    // unlock 看到 2 时会唤醒一个等待者, 被唤醒的线程同样以 2 重新加锁, 保证后续等待者不会丢失唤醒
+    while (atomic_exchange_explicit(&l->state, 2, memory_order_acquire) != 0) {
+        futex_wait(&l->state, 2);
+    }
+}
@@ -0,0 +1,72 @@
+#ifndef NATURE_FUTEX_H
+#define NATURE_FUTEX_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// 依赖 runtime.h 中定义的 ATOMIC, 需要通过 runtime.h 引入
+
+#define FUTEX_SPIN_COUNT 64 // 进入内核等待前的自旋次数
+#define FUTEX_SPIN_PAUSE_MAX 16 // 单次自旋中 cpu_relax 的次数上限, 按照 1,2,4.. 指数退避
+
+/**
+ * 自旋等待提示, 降低自旋期间的功耗与对超线程的干扰
+ */
+static inline void cpu_relax() {
+#if defined(__AMD64)
+    __asm__ volatile("pause" ::: "memory");
+#elif defined(__ARM64)
+    __asm__ volatile("yield" ::: "memory");
+#elif defined(__RISCV64)
+    // pause(Zihintpause), 编码为 fence w,0, 不支持的实现中等价于 nop
+    __asm__ volatile(".4byte 0x0100000f" ::: "memory");
+#else
+    __asm__ volatile("" ::: "memory");
+#endif
+}
+
+/**
+ * runtime 内部使用的线程级别的锁, 用于无法 yield coroutine 的场景(memory->locker/gc_stage_locker 等)
+ * state: 0 未加锁, 1 加锁且没有等待者, 2 加锁且可能存在等待者
+ * 无竞争时 lock/unlock 都只有一次原子操作, 竞争时短暂自旋后通过 futex 进入内核等待
+ */
+typedef struct {
+    ATOMIC uint32_t state;
+} futex_locker_t;
+
+void futex_wait(ATOMIC uint32_t *addr, uint32_t val);
+
+void futex_wake(ATOMIC uint32_t *addr, int count);
+
+void futex_lock_slow(futex_locker_t *l);
+
+static inline void futex_locker_init(futex_locker_t *l) {
+    atomic_store_explicit(&l->state, 0, memory_order_relaxed);
+}
+
+static inline bool futex_trylock(futex_locker_t *l) {
+    uint32_t expected = 0;
+    return atomic_compare_exchange_strong_explicit(&l->state, &expected, 1, memory_order_acquire,
+                                                   memory_order_relaxed);
+}
+
+static inline void futex_lock(futex_locker_t *l) {
+    if (__builtin_expect(futex_trylock(l), 1)) {
+        return;
+    }
+
+    futex_lock_slow(l);
+}
+
+static inline void futex_unlock(futex_locker_t *l) {
+    if (atomic_exchange_explicit(&l->state, 0, memory_order_release) == 2) {
+        futex_wake(&l->state, 1);
+    }
+}
+
+static inline bool futex_is_locked(futex_locker_t *l) {
+    return atomic_load_explicit(&l->state, memory_order_relaxed) != 0;
+}
+
+#endif // NATURE_FUTEX_H
@@ -10,7 +10,7 @@ uint64_t next_gc_bytes = 0; // 下一次 gc 的内存量
 bool gc_barrier; // gc 屏障开启标识
 
 uint8_t gc_stage; // gc 阶段
-mutex_t gc_stage_locker;
+futex_locker_t gc_stage_locker;
 
 memory_t *memory;
 
@@ -37,8 +37,23 @@ void callers_deserialize() {
     }
 }
 
+static fndef_t **fndef_sorted = NULL; // 按照 base 升序排列, rt_fndef_ptr 会被 caller 按照下标引用, 所以不能原地排序
+
+static int fndef_base_compare(const void *a, const void *b) {
+    addr_t left = (*(fndef_t **) a)->base;
+    addr_t right = (*(fndef_t **) b)->base;
+    return left < right ? -1 : (left > right ? 1 : 0);
+}
+
 void fndefs_deserialize() {
     rt_fndef_ptr = &rt_fndef_data;
+
+    fndef_sorted = mallocz(sizeof(fndef_t *) * (rt_fndef_count > 0 ? rt_fndef_count : 1));
+    for (int i = 0; i < rt_fndef_count; ++i) {
+        fndef_sorted[i] = &rt_fndef_ptr[i];
+    }
+    qsort(fndef_sorted, rt_fndef_count, sizeof(fndef_t *), fndef_base_compare);
+
     // debug
     //    for (int i = 0; i < rt_fndef_count; ++i) {
     //        fndef_t *fn = &rt_fndef_ptr[i];
@@ -48,6 +63,24 @@ void fndefs_deserialize() {
     DEBUGF("[fndefs_deserialize] rt_fndef_ptr addr: %p", rt_fndef_ptr);
 }
 
+fndef_t *fndef_lookup(addr_t pc) {
+    int64_t low = 0;
+    int64_t high = (int64_t) rt_fndef_count - 1;
+    while (low <= high) {
+        int64_t mid = low + (high - low) / 2;
+        fndef_t *fn = fndef_sorted[mid];
+        if (pc < fn->base) {
+            high = mid - 1;
+        } else if (pc >= fn->base + fn->size) {
+            low = mid + 1;
+        } else {
+            return fn;
+        }
+    }
+
+    return NULL;
+}
+
 /**
  * 链接器已经将 rt_type_data 和 rt_type_count 赋值完毕，
  * rt_type_data 应该直接可以使用,
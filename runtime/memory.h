@@ -20,7 +20,7 @@ extern uint64_t next_gc_bytes; // 下一次 gc 的内存量
 extern bool gc_barrier; // gc 屏障开启标识
 
 extern uint8_t gc_stage; // gc 阶段
-extern mutex_t gc_stage_locker;
+extern futex_locker_t gc_stage_locker;
 
 typedef enum {
     GC_STAGE_OFF, // 0 表示 gc 关闭, 这也是一个初始状态
@@ -189,6 +189,11 @@ void rtypes_deserialize();
 
 void fndefs_deserialize();
 
+/**
+ * 在按照 base 排序的 fndef 索引中二分查找 pc 所在的 fn, 不申请内存也不加锁, 可以在信号处理函数中使用
+ */
+fndef_t *fndef_lookup(addr_t pc);
+
 void callers_deserialize();
 
 void symdefs_deserialize();
@@ -217,6 +222,10 @@ void runtime_gc();
 
 void runtime_eval_gc();
 
+void gc_controller_init();
+
+void gc_controller_wake();
+
 void runtime_force_gc();
 
 void *gc_malloc(uint64_t rhash);
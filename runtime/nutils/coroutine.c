@@ -1,7 +1,11 @@
 #include "runtime/processor.h"
+#include "runtime/timer.h"
 
 coroutine_t *rt_coroutine_async(void *fn, int64_t flag, n_future_t *fu) {
     coroutine_t *co = rt_coroutine_new(fn, flag, fu, NULL);
+
+    // dispatch 之后 co 可能立即在其他 processor 中运行并退出，所以需要提前绑定
+    fu->co = co;
     rt_coroutine_dispatch(co);
     DEBUGF("[rt_coroutine_async] co=%p, fn=%p, flag=%ld, fu=%p, size=%ld", co, fn, flag, fu, fu->size);
 
@@ -14,8 +18,9 @@ void rt_coroutine_yield() {
 }
 
 void rt_select_block() {
-
-    co_yield_waiting(coroutine_get(), NULL, NULL);
+    coroutine_t *co = coroutine_get();
+    co->wait_reason = TRACE_REASON_SELECT;
+    co_yield_waiting(co, NULL, NULL);
 }
 
 
@@ -24,64 +29,41 @@ void *rt_coroutine_arg() {
     return co->arg;
 }
 
-static void uv_timer_close_cb(uv_handle_t *handle) {
-    free(handle);
-}
-
 /**
- * repeat 为 0， 所以不会重复执行，所以不需要手动钓孙 uv_stop_timer 停止计时器
- * @param timer
+ * 在 co->p 的 owner 线程中由 timer_wheel_run 回调
  */
-static void uv_on_timer(uv_timer_t *timer) {
-    RDEBUGF("[rt_coroutine_sleep.uv_on_timer] callback start, timer=%p, timer->data=%p", timer, timer->data);
+static void co_sleep_timer_cb(rt_timer_t *timer) {
     coroutine_t *co = timer->data;
-
-    // - 标记 coroutine 并推送到可调度队列中等待 processor handle
     n_processor_t *p = co->p;
     assert(p);
+    assert(p->status != P_STATUS_EXIT);
 
-    TRACEF("[rt_coroutine_sleep.uv_on_timer] will push to runnable_list, p_index=%d, co=%p, status=%d",
-           p->index, co, co->status);
+    TRACEF("[rt_coroutine_sleep.co_sleep_timer_cb] will push to runq, p_index=%d, co=%p, status=%d", p->index, co,
+           co->status);
 
     // timer 到时间了, push 到尾部等待调度
-    assert(p->status != P_STATUS_EXIT);
     co->status = CO_STATUS_RUNNABLE;
-    rt_linked_fixalloc_push(&p->runnable_list, co);
-
-    TRACEF("[rt_coroutine_sleep.uv_on_timer] will stop and clear timer=%p, p_index=%d, co=%p, status=%d", timer,
-           p->index, co, co->status);
-
-    uv_timer_stop(timer);
-
-    // 注册 close 事件而不是瞬时 close!
-    uv_close((uv_handle_t *) timer, uv_timer_close_cb);
-
-    TRACEF("[rt_coroutine_sleep.uv_on_timer] success stop and clear timer=%p, p_index=%d, co=%p, status=%d", timer,
-           p->index, co, co->status);
+    runq_put(p, co);
 }
 
 void rt_coroutine_sleep(int64_t ms) {
     n_processor_t *p = processor_get();
     coroutine_t *co = coroutine_get();
 
-    // - 初始化 libuv 定时器(io_run 回调会读取 timer 的地址，所以需要在堆中分配)
-    uv_timer_t *timer = NEW(uv_timer_t);
-    uv_timer_init(&p->uv_loop, timer);
-    timer->data = co;
-
-    // 设定定时器超时时间与回调
-    uv_timer_start(timer, uv_on_timer, ms, 0);
+    // 定时器嵌入在 coroutine 中，使用 processor 的时间轮，不需要申请 uv_timer
+    co->timer.fn = co_sleep_timer_cb;
+    co->timer.data = co;
+    timer_add(p, &co->timer, ms > 0 ? ms : 0);
 
-    DEBUGF("[runtime.rt_coroutine_sleep] start, co=%p uv_loop=%p, p_index=%d, timer=%p, timer_value=%lu", co,
-            &p->uv_loop, p->index, &timer, fetch_addr_value((addr_t) &timer));
+    DEBUGF("[runtime.rt_coroutine_sleep] start, co=%p, p_index=%d, ms=%ld, expire=%lu", co, p->index, ms,
+           co->timer.expire);
 
-    // 退出等待 io 事件就绪
+    // 退出等待定时器到期
+    co->wait_reason = TRACE_REASON_SLEEP;
     co_yield_waiting(co, NULL, NULL);
 
-    DEBUGF(
-            "[runtime.rt_coroutine_sleep] coroutine sleep resume, co=%p, co_status=%d, uv_loop=%p, p_index=%d, timer=%p",
-            co, co->status,
-            &p->uv_loop, p->index, &timer);
+    DEBUGF("[runtime.rt_coroutine_sleep] coroutine sleep resume, co=%p, co_status=%d, p_index=%d", co, co->status,
+           p->index);
 }
 
 
@@ -89,3 +71,56 @@ int64_t rt_processor_index() {
     coroutine_t *co = coroutine_get();
     return co->p->index;
 }
+
+int64_t rt_processor_count() {
+    return atomic_load(&processor_active_count);
+}
+
+int64_t rt_processor_set_count(int64_t n) {
+    if (n <= 0) {
+        return atomic_load(&processor_active_count);
+    }
+
+    if (n > cpu_count) {
+        n = cpu_count;
+    }
+
+    // 缩减后 index >= n 的 processor 继续运行已经开始执行的 coroutine, 其 runq 中未开始执行的 coroutine 会被窃取
+    int64_t old = atomic_exchange(&processor_active_count, n);
+    DEBUGF("[runtime.rt_processor_set_count] active processor count %ld -> %ld", old, n);
+    return old;
+}
+
+n_vec_t *rt_sched_histogram(int64_t kind, int64_t p_index) {
+    if (kind < 0 || kind >= SCHED_HIST_MAX) {
+        rti_throw(tlsprintf("sched histogram kind %ld out of range", kind), true);
+        return NULL;
+    }
+
+    if (p_index >= cpu_count) {
+        rti_throw(tlsprintf("processor index %ld out of range [0, %d)", p_index, cpu_count), true);
+        return NULL;
+    }
+
+    // [count, sum_ns, buckets...], 其他 processor 可能正在写入，这里只保证各个字段自身读取完整
+    uint64_t values[SCHED_HIST_BUCKETS + 2] = {0};
+    for (int64_t i = 0; i < cpu_count; ++i) {
+        if (p_index >= 0 && i != p_index) {
+            continue;
+        }
+
+        sched_hist_t *hist = &processor_index[i]->sched_hist[kind];
+        values[0] += hist->count;
+        values[1] += hist->sum;
+        for (int j = 0; j < SCHED_HIST_BUCKETS; ++j) {
+            values[j + 2] += hist->buckets[j];
+        }
+    }
+
+    n_vec_t *list = rti_vec_new(&uint64_rtype, SCHED_HIST_BUCKETS + 2, SCHED_HIST_BUCKETS + 2);
+    for (int i = 0; i < SCHED_HIST_BUCKETS + 2; ++i) {
+        rti_vec_assign(list, i, &values[i]);
+    }
+
+    return list;
+}
@@ -0,0 +1,174 @@
+#include "libc.h"
+
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "runtime/runtime.h"
+
+void libc_sleep(n_int_t second) {
+    pre_tplcall_hook();
+    sleep((unsigned int) second);
+    post_tplcall_hook();
+}
+
+int32_t libc_usleep(n_u32_t usec) {
+    pre_tplcall_hook();
+    int32_t result = usleep(usec);
+    post_tplcall_hook();
+    return result;
+}
+
+int32_t libc_nanosleep(struct timespec *req, struct timespec *rem) {
+    pre_tplcall_hook();
+    int32_t result = nanosleep(req, rem);
+    post_tplcall_hook();
+    return result;
+}
+
+int32_t libc_clock_nanosleep(int32_t clk_id, int32_t flags, struct timespec *req, struct timespec *rem) {
+#ifdef __DARWIN
+    // darwin 没有 clock_nanosleep, 仅支持相对时间
+    return libc_nanosleep(req, rem);
+#else
+    pre_tplcall_hook();
+    int32_t result = clock_nanosleep(clk_id, flags, req, rem);
+    post_tplcall_hook();
+    return result;
+#endif
+}
+
+int32_t libc_pause() {
+    pre_tplcall_hook();
+    int32_t result = pause();
+    post_tplcall_hook();
+    return result;
+}
+
+int32_t libc_system(char *command) {
+    pre_tplcall_hook();
+    int32_t result = system(command);
+    post_tplcall_hook();
+    return result;
+}
+
+n_int_t libc_waitpid(n_int_t pid, int *status, n_int_t options) {
+    pre_tplcall_hook();
+    n_int_t result = waitpid((pid_t) pid, status, (int) options);
+    post_tplcall_hook();
+    return result;
+}
+
+int64_t libc_read(int32_t fd, void *buf, uint64_t count) {
+    pre_tplcall_hook();
+    int64_t result = read(fd, buf, count);
+    post_tplcall_hook();
+    return result;
+}
+
+int64_t libc_write(int32_t fd, void *buf, uint64_t count) {
+    pre_tplcall_hook();
+    int64_t result = write(fd, buf, count);
+    post_tplcall_hook();
+    return result;
+}
+
+int64_t libc_pread(int32_t fd, void *buf, uint64_t count, int64_t offset) {
+    pre_tplcall_hook();
+    int64_t result = pread(fd, buf, count, offset);
+    post_tplcall_hook();
+    return result;
+}
+
+int64_t libc_pwrite(int32_t fd, void *buf, uint64_t count, int64_t offset) {
+    pre_tplcall_hook();
+    int64_t result = pwrite(fd, buf, count, offset);
+    post_tplcall_hook();
+    return result;
+}
+
+uint64_t libc_fread(void *ptr, uint64_t size, uint64_t nmemb, FILE *stream) {
+    pre_tplcall_hook();
+    uint64_t result = fread(ptr, size, nmemb, stream);
+    post_tplcall_hook();
+    return result;
+}
+
+uint64_t libc_fwrite(void *ptr, uint64_t size, uint64_t nmemb, FILE *stream) {
+    pre_tplcall_hook();
+    uint64_t result = fwrite(ptr, size, nmemb, stream);
+    post_tplcall_hook();
+    return result;
+}
+
+int32_t libc_fgetc(FILE *stream) {
+    pre_tplcall_hook();
+    int32_t result = fgetc(stream);
+    post_tplcall_hook();
+    return result;
+}
+
+int32_t libc_getc(FILE *stream) {
+    pre_tplcall_hook();
+    int32_t result = getc(stream);
+    post_tplcall_hook();
+    return result;
+}
+
+int32_t libc_getchar() {
+    pre_tplcall_hook();
+    int32_t result = getchar();
+    post_tplcall_hook();
+    return result;
+}
+
+char *libc_fgets(char *s, int32_t size, FILE *stream) {
+    pre_tplcall_hook();
+    char *result = fgets(s, size, stream);
+    post_tplcall_hook();
+    return result;
+}
+
+int64_t libc_getdelim(char **lineptr, uint64_t *n, int32_t delim, FILE *stream) {
+    pre_tplcall_hook();
+    int64_t result = getdelim(lineptr, n, delim, stream);
+    post_tplcall_hook();
+    return result;
+}
+
+int64_t libc_getline(char **lineptr, uint64_t *n, FILE *stream) {
+    pre_tplcall_hook();
+    int64_t result = getline(lineptr, n, stream);
+    post_tplcall_hook();
+    return result;
+}
+
+// open fifo 或者 tty 时可能阻塞
+int32_t libc_open(char *pathname, int32_t flags, uint32_t mode) {
+    pre_tplcall_hook();
+    int32_t result = open(pathname, flags, mode);
+    post_tplcall_hook();
+    return result;
+}
+
+int32_t libc_openat(int32_t dirfd, char *pathname, int32_t flags, uint32_t mode) {
+    pre_tplcall_hook();
+    int32_t result = openat(dirfd, pathname, flags, mode);
+    post_tplcall_hook();
+    return result;
+}
+
+// F_SETLKW 会阻塞到获取文件锁为止
+int32_t libc_fcntl(int32_t fd, int32_t cmd, void *flag) {
+    pre_tplcall_hook();
+    int32_t result = fcntl(fd, cmd, flag);
+    post_tplcall_hook();
+    return result;
+}
+
+int32_t libc_lockf(int32_t fd, int32_t cmd, int64_t len) {
+    pre_tplcall_hook();
+    int32_t result = lockf(fd, cmd, len);
+    post_tplcall_hook();
+    return result;
+}
@@ -0,0 +1,60 @@
+#ifndef NATURE_LIBC_H
+#define NATURE_LIBC_H
+
+#include <stdio.h>
+#include <time.h>
+
+#include "utils/type.h"
+
+/**
+ * std/libc 中可能长时间阻塞的函数, 调用前后通过 pre/post_tplcall_hook 通知调度器,
+ * 阻塞期间 processor 不会被抢占, runq 中的 coroutine 会被 sysmon 转移到其他 processor 中运行
+ */
+
+void libc_sleep(n_int_t second);
+
+int32_t libc_usleep(n_u32_t usec);
+
+int32_t libc_nanosleep(struct timespec *req, struct timespec *rem);
+
+int32_t libc_clock_nanosleep(int32_t clk_id, int32_t flags, struct timespec *req, struct timespec *rem);
+
+int32_t libc_pause();
+
+int32_t libc_system(char *command);
+
+n_int_t libc_waitpid(n_int_t pid, int *status, n_int_t options);
+
+int64_t libc_read(int32_t fd, void *buf, uint64_t count);
+
+int64_t libc_write(int32_t fd, void *buf, uint64_t count);
+
+int64_t libc_pread(int32_t fd, void *buf, uint64_t count, int64_t offset);
+
+int64_t libc_pwrite(int32_t fd, void *buf, uint64_t count, int64_t offset);
+
+uint64_t libc_fread(void *ptr, uint64_t size, uint64_t nmemb, FILE *stream);
+
+uint64_t libc_fwrite(void *ptr, uint64_t size, uint64_t nmemb, FILE *stream);
+
+int32_t libc_fgetc(FILE *stream);
+
+int32_t libc_getc(FILE *stream);
+
+int32_t libc_getchar();
+
+char *libc_fgets(char *s, int32_t size, FILE *stream);
+
+int64_t libc_getdelim(char **lineptr, uint64_t *n, int32_t delim, FILE *stream);
+
+int64_t libc_getline(char **lineptr, uint64_t *n, FILE *stream);
+
+int32_t libc_open(char *pathname, int32_t flags, uint32_t mode);
+
+int32_t libc_openat(int32_t dirfd, char *pathname, int32_t flags, uint32_t mode);
+
+int32_t libc_fcntl(int32_t fd, int32_t cmd, void *flag);
+
+int32_t libc_lockf(int32_t fd, int32_t cmd, int64_t len);
+
+#endif //NATURE_LIBC_H
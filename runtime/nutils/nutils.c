@@ -623,6 +623,23 @@ void write_barrier(void *slot, void *new_obj) {
     rti_write_barrier_ptr(slot, new_obj, false);
 }
 
+/**
+ * @atomic_store/@atomic_swap/@atomic_cas 的写屏障, 赋值由编译器生成的原子指令完成，此处仅进行着色
+ */
+void write_barrier_shade(void *slot, void *new_obj) {
+    if (!gc_barrier_get()) {
+        return;
+    }
+
+    DEBUGF("[runtime_gc.write_barrier_shade] slot: %p, new_obj: %p", slot, new_obj);
+    shade_obj_grey(slot);
+
+    coroutine_t *co = coroutine_get();
+    if (co->gc_black < memory->gc_count && new_obj) {
+        shade_obj_grey(new_obj);
+    }
+}
+
 void rawptr_valid(void *rawptr) {
     // 修改状态避免抢占
     DEBUGF("[rawptr_valid] rawptr=%p", rawptr);
@@ -66,7 +66,9 @@ void syscall_exec(n_string_t *path, n_vec_t *argv, n_vec_t *envp) {
 // 使用 waitpid, 返回值为 exit status
 n_u32_t syscall_wait(n_int_t pid) {
     int status;
+    pre_tplcall_hook();
     int result = waitpid((pid_t) pid, &status, 0);
+    post_tplcall_hook();
     if (result == -1) {
         rti_throw(strerror(errno), false);
         return 0;
@@ -76,7 +78,10 @@ n_u32_t syscall_wait(n_int_t pid) {
 }
 
 n_int_t syscall_call6(n_int_t number, n_uint_t a1, n_uint_t a2, n_uint_t a3, n_uint_t a4, n_uint_t a5, n_uint_t a6) {
+    // read/wait4 等系统调用可能长时间阻塞
+    pre_tplcall_hook();
     int64_t result = syscall(number, a1, a2, a3, a4, a5, a6);
+    post_tplcall_hook();
 
     if (result == -1) {
         rti_throw(strerror(errno), false);
@@ -1,21 +1,34 @@
 #include "processor.h"
 
 #include <ucontext.h>
+#ifdef __LINUX
+#include <dirent.h>
+#include <sched.h>
+#endif
 
+#include "blocking.h"
+#include "costack.h"
+#include "rt_pool.h"
 #include "nutils/errort.h"
 #include "nutils/rt_signal.h"
 #include "runtime.h"
 #include "runtime/nutils/http.h"
+#include "timer.h"
 
 int cpu_count;
+sched_tunables_t sched_tunables;
+ATOMIC int64_t processor_active_count;
 
-n_processor_t *processor_index[1024] = {0};
+n_processor_t *processor_index[PROCESSOR_MAX] = {0};
 n_processor_t *processor_list; // 共享协程列表的数量一般就等于线程数量
 
 //n_processor_t *solo_processor_list; // 独享协程列表其实就是多线程
 //mutex_t solo_processor_locker; // 删除 solo processor 需要先获取该锁
 
-int64_t coroutine_count; // coroutine 累计数量
+ATOMIC int64_t coroutine_count; // coroutine 累计数量
+ATOMIC int64_t processor_spinning_count; // 正在自旋窃取的 processor 数量
+static mutex_t future_lockers[FUTURE_LOCKER_COUNT]; // 见 future_locker
+ATOMIC int64_t processor_parked_count; // park 在 uv_loop 中的 processor 数量, 用于 processor_wakep 快速判断
 bool main_coroutine_exited = false;
 
 rt_linked_fixalloc_t global_gc_worklist;
@@ -71,10 +84,12 @@ NO_OPTIMIZE void co_preempt_yield() {
             p->index, p->status, co, co->status, p->co_started_at / 1000 / 1000, (void *) assist_preempt_yield_ret_addr);
 
     p->status = P_STATUS_PREEMPT; // 抢占返回标志
+    p->preempted = true;
 
     // 不需要等待，直接设置为 runnable 状态
     co->status = CO_STATUS_RUNNABLE;
-    rt_linked_fixalloc_push(&p->runnable_list, co);
+    trace_event(TRACE_CO_YIELD, co->id, TRACE_REASON_PREEMPT);
+    runq_put(p, co);
 
     *p->tls_yield_safepoint_ptr = false; // 清空状态
     DEBUGF("[runtime.co_preempt_yield] co=%p push and update status success", co);
@@ -93,6 +108,116 @@ NO_OPTIMIZE void co_preempt_yield() {
 }
 
 /**
+ * 判断 pc 是否处于可以异步抢占的位置
+ * 仅 nature fn 的函数体可以被抢占，此时 bp 指向当前函数的栈帧，scan_stack 可以基于 fndef 扫描栈帧
+ * fn_begin 中 bp 还未更新或者 fn_end 中 bp 已经恢复为 caller 的值时都不能抢占
+ */
+static bool preempt_async_safe(fndef_t *fn, addr_t pc, addr_t sp) {
+#ifdef __AMD64
+    // push rbp; mov rbp, rsp(48 8b ec 或者 48 89 e5)
+    uint8_t *begin = (uint8_t *) fn->base;
+    if (begin[0] != 0x55 || begin[1] != 0x48 ||
+        !((begin[2] == 0x8b && begin[3] == 0xec) || (begin[2] == 0x89 && begin[3] == 0xe5))) {
+        return false;
+    }
+
+    if (pc < fn->base + 4) {
+        return false;
+    }
+
+    // pop rbp 之后的 ret
+    if (*(uint8_t *) pc == 0xc3) {
+        return false;
+    }
+
+    // assist_preempt_yield 会通过 call co_preempt_yield 进入 c 代码，需要保证栈是 16byte 对齐的(push 与 pop 之间)
+    return (sp & 15) == 0;
+#elif defined(__ARM64)
+    // stp x29, x30, [sp, #-16]!; mov x29, sp
+    uint32_t *begin = (uint32_t *) fn->base;
+    if (begin[0] != 0xa9bf7bfd || begin[1] != 0x910003fd) {
+        return false;
+    }
+
+    if (pc < fn->base + 8) {
+        return false;
+    }
+
+    // ldp x29, x30, [sp], #16 之后的 ret
+    return *(uint32_t *) pc != 0xd65f03c0;
+#else
+    // riscv64 的 assist_preempt_yield 还没有适配异步抢占，依旧依赖 safepoint 协作式抢占
+    return false;
+#endif
+}
+
+#ifdef __AMD64
+/**
+ * 判断 ret 是否是 call 指令的返回地址(call rel32 或者 call reg)
+ */
+static bool preempt_after_call(addr_t ret) {
+    uint8_t *code = (uint8_t *) ret;
+    if (code[-5] == 0xe8) {
+        return true;
+    }
+
+    return code[-2] == 0xff && (code[-1] & 0xf8) == 0xd0;
+}
+
+/**
+ * 基于 rbp 链查找 c 函数返回到 nature fn 的返回地址，并将其替换为 assist_preempt_return
+ * libc 中的函数可能没有保留 rbp, 所以需要对 rbp 链的每一步都进行校验，校验失败时放弃本次抢占
+ */
+static bool preempt_hijack_return(coroutine_t *co, addr_t bp, addr_t sp, addr_t stack_base) {
+    if (co->preempt_ret_addr) {
+        return false;
+    }
+
+    for (int i = 0; i < PREEMPT_HIJACK_DEPTH; ++i) {
+        if (bp < sp || bp + POINTER_SIZE * 2 > stack_base || (bp & (POINTER_SIZE - 1))) {
+            return false;
+        }
+
+        addr_t ret = fetch_addr_value(bp + POINTER_SIZE);
+        if (ret == (addr_t) assist_preempt_return) {
+            return false;
+        }
+
+        if (fndef_lookup(ret)) {
+            if (!preempt_after_call(ret)) {
+                return false;
+            }
+
+            co->preempt_ret_addr = ret;
+            *(addr_t *) (bp + POINTER_SIZE) = (addr_t) assist_preempt_return;
+            return true;
+        }
+
+        addr_t prev_bp = fetch_addr_value(bp);
+        if (prev_bp <= bp) {
+            return false;
+        }
+        bp = prev_bp;
+    }
+
+    return false;
+}
+
+/**
+ * assist_preempt_return 中调用，取回被替换的返回地址
+ */
+addr_t co_preempt_return_addr() {
+    coroutine_t *co = coroutine_get();
+    addr_t ret = co->preempt_ret_addr;
+    assert(ret);
+    co->preempt_ret_addr = 0;
+    return ret;
+}
+#endif
+
+/**
+ * 异步抢占信号处理，sysmon 设置 tls_yield_safepoint 后 coroutine 长时间没有经过 safepoint 时触发
+ * 如果 pc 处于 nature fn 中的安全位置，则修改上下文模拟一次 call assist_preempt_yield, 否则等待下一次信号或者 safepoint
  * 不能在信号处理函数中调用不可重入函数，包括 malloc/free/printf 等
  * @param sig
  * @param info
@@ -101,50 +226,28 @@ NO_OPTIMIZE void co_preempt_yield() {
 NO_OPTIMIZE static void thread_handle_sig(int sig, siginfo_t *info, void *ucontext) {
     ucontext_t *ctx = ucontext;
     n_processor_t *p = processor_get();
-    assert(p);
+    if (!p || p->status != P_STATUS_RUNNING) {
+        return;
+    }
+
     coroutine_t *co = p->coroutine;
-    assert(co);
+    if (!co || (co->flag & FLAG(CO_FLAG_RTFN))) {
+        return;
+    }
 
+    // 已经通过 safepoint 让出
+    if (!p->tls_yield_safepoint_ptr || !*p->tls_yield_safepoint_ptr) {
+        return;
+    }
 
 #ifdef __AMD64
 #ifdef __LINUX
-#define CTX_RSP ctx->uc_mcontext.gregs[REG_RSP]
-#define CTX_RIP ctx->uc_mcontext.gregs[REG_RIP]
+#define CTX_SP ctx->uc_mcontext.gregs[REG_RSP]
+#define CTX_PC ctx->uc_mcontext.gregs[REG_RIP]
 #else // darwin
-#define CTX_RSP ctx->uc_mcontext->__ss.__rsp
-#define CTX_RIP ctx->uc_mcontext->__ss.__rip
+#define CTX_SP ctx->uc_mcontext->__ss.__rsp
+#define CTX_PC ctx->uc_mcontext->__ss.__rip
 #endif
-    // int REG_RBP = 10;
-    int REG_RSP = 15;
-    int REG_RIP = 16;
-    uint64_t *rsp = (uint64_t *) CTX_RSP;
-    uint64_t rip = CTX_RIP;
-    // rip 已经存到了 rsp 里面,只要能定位到 bp_offset 就行了。
-    fndef_t *fn = find_fn(rip, p);
-    if (fn) {
-        // 基于当前 rsp scan
-        uint64_t sp_addr = (uint64_t) rsp;
-        //        co->scan_ret_addr = rip;
-        //        co->scan_offset = (uint64_t) co->p->share_stack.align_retptr - sp_addr;
-    } else {
-        // c 语言段被抢占，采取保守的扫描策略(使用 ret_addr = 0 来识别)
-        //        co->scan_ret_addr = 0;
-        //        co->scan_offset = (uint64_t) co->p->share_stack.align_retptr - (uint64_t) rsp;
-    }
-
-    // 由于被抢占的函数可以会在没有 sub 保留 rsp 的情况下使用 rsp-0x10 这样的空间地址
-    // 所以需要为 rsp 预留足够的栈空间给被抢占的函数, 避免后续的操作污染被抢占的函数
-    rsp -= 128; // 一个指针是 8byte, 所以这里是 128 * 8 = 1024 个字节
-    // push rip
-    rsp--; // 栈中预留返回地址
-    *rsp = rip;
-    RDEBUGF("[runtime.thread_handle_sig] rip=%p save to %p, co=%p, scan_ret_addr=%p, scan_offset=%lu, fn=%p",
-            (void *) rip, rsp, co,
-            (void *) co->scan_ret_addr, co->scan_offset, fn);
-
-    CTX_RSP = (int64_t) rsp;
-    CTX_RIP = (int64_t) assist_preempt_yield;
-
 #elif defined(__ARM64)
 #ifdef __LINUX
 #define CTX_SP ctx->uc_mcontext.sp
@@ -154,84 +257,79 @@ NO_OPTIMIZE static void thread_handle_sig(int sig, siginfo_t *info, void *uconte
 #define CTX_SP ctx->uc_mcontext->__ss.__sp
 #define CTX_PC ctx->uc_mcontext->__ss.__pc
 #define CTX_LR ctx->uc_mcontext->__ss.__lr
+#endif
+#elif defined(__RISCV64)
+#define CTX_SP ctx->uc_mcontext.__gregs[2] // x2 是栈指针 (sp)
+#define CTX_PC ctx->uc_mcontext.__gregs[0] // pc 寄存器
+#else
+#error "platform no support yet"
 #endif
 
-    uint64_t *sp = (uint64_t *) CTX_SP;
-    uint64_t pc = CTX_PC;
-    uint64_t lr = CTX_LR; // 保存返回地址的链接寄存器
-
-    // 查找当前执行的函数(协作式调度，必然能够被找到才行)
-    fndef_t *fn = find_fn(pc, p);
-    if (fn) {
-        // 基于当前 sp 计算扫描偏移
-        uint64_t sp_addr = (uint64_t) sp;
-        //        co->scan_ret_addr = pc;
-        //        co->scan_offset = (uint64_t) co->p->share_stack.align_retptr - sp_addr;
-    } else {
-        // c 语言段被抢占,采用保守扫描策略
-        //        co->scan_ret_addr = 0;
-        //        co->scan_offset = (uint64_t) co->p->share_stack.align_retptr - (uint64_t) sp;
-    }
-
-    // 为被抢占的函数预留栈空间
-    sp -= 128; // 1024 字节的安全区域
-
-    // ARM64 中保存返回地址和链接寄存器
-    sp -= 2; // 预留两个位置,一个给 pc,一个给 lr
-    sp[0] = pc;
-    sp[1] = lr;
+    addr_t sp = (addr_t) CTX_SP;
+    addr_t pc = (addr_t) CTX_PC;
 
-    RDEBUGF("[runtime.thread_handle_sig] pc=%p lr=%p save to %p, co=%p, fn=%p",
-            (void *) pc, (void *) lr, sp, co, fn);
+    // 必须运行在 coroutine 的栈中(share_stack 或者独立栈)
+    aco_share_stack_t *stack = co->aco.share_stack;
+    if (!stack || sp <= (addr_t) stack->ptr || sp >= (addr_t) stack->align_retptr) {
+        return;
+    }
 
-    // 更新上下文
-    CTX_SP = (uint64_t) sp;
-    CTX_PC = (uint64_t) assist_preempt_yield;
-    CTX_LR = (uint64_t) assist_preempt_yield; // 确保返回地址也指向抢占处理函数
+    fndef_t *fn = fndef_lookup(pc);
+#ifdef __AMD64
+    // pc 位于 c 函数中(runtime 或者 libc), 替换返回到 nature fn 的返回地址，c 函数返回后再进行抢占
+    if (!fn) {
+        bool hijacked = preempt_hijack_return(co, (addr_t) ctx->uc_mcontext.gregs[REG_RBP], sp,
+                                              (addr_t) stack->align_retptr);
+        RDEBUGF("[runtime.thread_handle_sig] pc=%p in c fn, co=%p, hijack return=%d", (void *) pc, co, hijacked);
+        return;
+    }
+#endif
 
-#elif defined(__RISCV64)
-    // RISCV64 架构支持
-    // 在 RISCV64 Linux 下，寄存器通过 __gregs 数组访问
-#define CTX_SP ctx->uc_mcontext.__gregs[2] // x2 是栈指针 (sp)
-#define CTX_PC ctx->uc_mcontext.__gregs[0] // pc 寄存器
-#define CTX_RA ctx->uc_mcontext.__gregs[1] // x1 是返回地址寄存器 (ra)
-
-    uint64_t *sp = (uint64_t *) CTX_SP;
-    uint64_t pc = CTX_PC;
-    uint64_t ra = CTX_RA; // 保存返回地址寄存器
-
-    // 查找当前执行的函数
-    fndef_t *fn = find_fn(pc, p);
-    if (fn) {
-        // 基于当前 sp 计算扫描偏移
-        uint64_t sp_addr = (uint64_t) sp;
-        //        co->scan_ret_addr = pc;
-        //        co->scan_offset = (uint64_t) co->p->share_stack.align_retptr - sp_addr;
-    } else {
-        // c 语言段被抢占,采用保守扫描策略
-        //        co->scan_ret_addr = 0;
-        //        co->scan_offset = (uint64_t) co->p->share_stack.align_retptr - (uint64_t) sp;
+    if (!fn || !preempt_async_safe(fn, pc, sp)) {
+        RDEBUGF("[runtime.thread_handle_sig] pc=%p not async safe, co=%p, fn=%p", (void *) pc, co, fn);
+        return;
     }
 
-    // 为被抢占的函数预留栈空间
-    sp -= 128; // 1024 字节的安全区域
+#ifdef __AMD64
+    // 模拟 call assist_preempt_yield, 将 pc 作为返回地址压栈，assist_preempt_yield ret 之后 rsp 会恢复原值
+    // nature fn 在 fn_begin 中分配了完整的栈帧，不会使用 rsp 以下的空间，所以不需要预留 red zone
+    sp -= POINTER_SIZE;
+    *(addr_t *) sp = pc;
+    CTX_SP = (int64_t) sp;
+    CTX_PC = (int64_t) assist_preempt_yield;
+#elif defined(__ARM64)
+    // 模拟 bl assist_preempt_yield, nature fn 在 fn_begin 中已经将 lr 保存到了栈帧中，函数体中 lr 不参与寄存器分配
+    CTX_LR = (uint64_t) pc;
+    CTX_PC = (uint64_t) assist_preempt_yield;
+#endif
 
-    // RISCV64 中保存程序计数器和返回地址
-    sp -= 2; // 预留两个位置,一个给 pc,一个给 ra
-    sp[0] = pc;
-    sp[1] = ra;
+    RDEBUGF("[runtime.thread_handle_sig] co=%p preempt at pc=%p, fn=%s", co, (void *) pc, STRTABLE(fn->name_offset));
+}
 
-    RDEBUGF("[runtime.thread_handle_sig] pc=%p ra=%p save to %p, co=%p, fn=%p",
-            (void *) pc, (void *) ra, sp, co, fn);
+/**
+ * 注册异步抢占信号处理函数(进程维度)
+ */
+static void preempt_signal_init() {
+    struct sigaction act;
+    memset(&act, 0, sizeof act);
+    sigemptyset(&act.sa_mask);
+    act.sa_sigaction = thread_handle_sig;
+    act.sa_flags = SA_SIGINFO | SA_RESTART;
+
+    if (sigaction(PREEMPT_SIGNAL, &act, NULL) < 0) {
+        DEBUGF("[runtime.preempt_signal_init] cannot install preempt signal handler: %s", strerror(errno));
+    }
+}
 
-    // 更新上下文
-    CTX_SP = (uint64_t) sp;
-    CTX_PC = (uint64_t) assist_preempt_yield;
-    CTX_RA = (uint64_t) assist_preempt_yield; // 确保返回地址也指向抢占处理函数
+/**
+ * sysmon 中调用，向 p 所在的线程发送异步抢占信号
+ */
+void processor_preempt_signal(n_processor_t *p) {
+    if (p->thread_id == 0) {
+        return;
+    }
 
-#else
-#error "platform no support yet"
-#endif
+    pthread_kill(p->thread_id, PREEMPT_SIGNAL);
 }
 
 static void processor_uv_close(n_processor_t *p) {
@@ -255,6 +353,34 @@ static void processor_uv_close(n_processor_t *p) {
     RDEBUGF("[runtime.processor_uv_close] processor uv close success p_index=%d", p->index);
 }
 
+/**
+ * await 与 coroutine 退出之间的同步锁按照 future 地址分段。coroutine 退出后会被 gc 回收并在 co_cache 中 memset 复用,
+ * 等待方在加锁之前无法确认 future->co 是否已经被复用, 所以不能使用 coroutine 中的锁; 而 future 同时被等待方与
+ * coroutine 引用, 在此期间不会被 gc 回收
+ */
+static inline mutex_t *future_locker(n_future_t *future) {
+    return &future_lockers[((addr_t) future >> 4) & (FUTURE_LOCKER_COUNT - 1)];
+}
+
+/**
+ * 在 future_locker 中调用, pending 归零时唤醒 waiter, 唤醒之后不能再访问 group
+ * @return waiter 是否会观察到当前 coroutine 的结果, await_any 已经触发之后退出的 coroutine 返回 false
+ */
+static bool await_group_done(n_processor_t *p, await_group_t *group) {
+    if (group->any && atomic_exchange(&group->fired, true)) {
+        return false;
+    }
+
+    coroutine_t *waiter = group->waiter;
+    if (atomic_fetch_sub(&group->pending, 1) != 1) {
+        return true;
+    }
+
+    co_set_status(p, waiter, CO_STATUS_RUNNABLE);
+    runq_put_next(waiter->p, waiter);
+    return true;
+}
+
 NO_OPTIMIZE static void coroutine_wrapper() {
     coroutine_t *co = aco_get_arg();
     assert(co);
@@ -287,14 +413,35 @@ NO_OPTIMIZE static void coroutine_wrapper() {
         co->future->error = union_casting(throwable_rtype.hash, &co->error); // 将 co error 赋值给 co->future 避免被 gc
     }
 
-    // co->await_co 可能是随时写入的，所以需要 dead_locker 保证同步
-    mutex_lock(&co->dead_locker);
+    // co->await_co 可能是随时写入的，所以需要 future_locker 保证同步, 没有 future 的 coroutine 无法被等待
+    mutex_t *locker = co->future ? future_locker(co->future) : NULL;
+    if (locker) {
+        mutex_lock(locker);
+    }
+
+    // 需要在 future->co 置空之前完成, await_any 看到 future->co 为空时会认为 group 已经不再被访问
+    bool has_group = false;
+    await_group_node_t *node = co->await_groups;
+    while (node) {
+        await_group_node_t *next = node->next;
+        if (await_group_done(p, node->group)) {
+            has_group = true;
+        }
+        free(node);
+        node = next;
+    }
+    co->await_groups = NULL;
+
+    if (co->future) {
+        co->future->co = NULL;
+    }
+
     if (co->await_co) {
         coroutine_t *await_co = co->await_co;
 
         co_set_status(p, await_co, CO_STATUS_RUNNABLE);
-        rt_linked_fixalloc_push(&await_co->p->runnable_list, await_co);
-    } else {
+        runq_put_next(await_co->p, await_co);
+    } else if (!has_group) {
         if (co->has_error) {
             coroutine_dump_error(co);
             exit(EXIT_FAILURE);
@@ -307,12 +454,124 @@ NO_OPTIMIZE static void coroutine_wrapper() {
         DEBUGF("[runtime.coroutine_wrapper] co=%p main exited", co);
     }
 
-    mutex_unlock(&co->dead_locker);
+    if (locker) {
+        mutex_unlock(locker);
+    }
+
+    if (co->flag & FLAG(CO_FLAG_BLOCKING)) {
+        blocking_done(p);
+    }
 
     DEBUGF("[runtime.coroutine_wrapper] co=%p will dead", co);
+    trace_event(TRACE_CO_EXIT, co->id, 0);
+    costack_profile_update(co);
     aco_exit1(&co->aco);
 }
 
+/**
+ * 从 p->co_cache 中获取 coroutine, 缓存为空时在一次加锁中从 coroutine_alloc 批量补充
+ * 非 processor 线程(p 为 null)直接加锁申请
+ */
+static coroutine_t *coroutine_alloc_cached(n_processor_t *p) {
+    if (!p) {
+        mutex_lock(&cp_alloc_locker);
+        coroutine_t *co = fixalloc_alloc(&coroutine_alloc);
+        mutex_unlock(&cp_alloc_locker);
+        return co;
+    }
+
+    if (!p->co_cache) {
+        mutex_lock(&cp_alloc_locker);
+        for (int i = 0; i < P_CO_CACHE_BATCH; ++i) {
+            coroutine_t *co = fixalloc_alloc(&coroutine_alloc);
+            co->next = p->co_cache;
+            p->co_cache = co;
+        }
+        mutex_unlock(&cp_alloc_locker);
+        p->co_cache_count += P_CO_CACHE_BATCH;
+    }
+
+    coroutine_t *co = p->co_cache;
+    p->co_cache = co->next;
+    p->co_cache_count--;
+
+    // 与 fixalloc_alloc 保持一致清空所有字段
+    memset(co, 0, sizeof(coroutine_t));
+    return co;
+}
+
+static inline int save_stack_class(size_t sz) {
+    int index = 0;
+    while (((size_t) 1 << (index + SAVE_STACK_MIN_SHIFT)) < sz) {
+        index++;
+    }
+    return index;
+}
+
+/**
+ * run_blocking 工作 processor 不运行 gc_work, 缓存无法被标记, 所以不使用本地缓存
+ */
+static inline n_processor_t *save_stack_cache_owner() {
+    n_processor_t *p = processor_get();
+    if (!p || p->blocking) {
+        return NULL;
+    }
+    return p;
+}
+
+void *save_stack_alloc(size_t *sz) {
+    int index = save_stack_class(*sz);
+    *sz = (size_t) 1 << (index + SAVE_STACK_MIN_SHIFT);
+
+    n_processor_t *p = save_stack_cache_owner();
+    if (index >= SAVE_STACK_CLASS_COUNT || !p || !p->save_stack_cache[index]) {
+        return rti_gc_malloc(*sz, NULL);
+    }
+
+    void *ptr = p->save_stack_cache[index];
+    p->save_stack_cache[index] = *(void **) ptr;
+    p->save_stack_cache_count[index]--;
+
+    // gc_work 标记缓存之后取出的 save_stack 可能被分配给已经完成扫描的 coroutine
+    rt_shade_obj_with_barrier(ptr);
+    return ptr;
+}
+
+void save_stack_release(void *ptr, size_t sz) {
+    if (!ptr) {
+        return;
+    }
+
+    int index = save_stack_class(sz);
+    n_processor_t *p = save_stack_cache_owner();
+    if (index >= SAVE_STACK_CLASS_COUNT || ((size_t) 1 << (index + SAVE_STACK_MIN_SHIFT)) != sz || !p ||
+        p->save_stack_cache_count[index] >= P_SAVE_STACK_CACHE_MAX) {
+        return;
+    }
+
+    // 释放时所属的 coroutine 可能尚未被扫描, 需要主动着色避免在本轮被清理
+    rt_shade_obj_with_barrier(ptr);
+
+    *(void **) ptr = p->save_stack_cache[index];
+    p->save_stack_cache[index] = ptr;
+    p->save_stack_cache_count[index]++;
+}
+
+/**
+ * p->co_cache 已满时在一次加锁中将 P_CO_CACHE_BATCH 个 coroutine 归还到 coroutine_alloc
+ */
+static void coroutine_cache_spill(n_processor_t *p) {
+    mutex_lock(&cp_alloc_locker);
+    for (int i = 0; i < P_CO_CACHE_BATCH && p->co_cache; ++i) {
+        coroutine_t *co = p->co_cache;
+        p->co_cache = co->next;
+        p->co_cache_count--;
+
+        fixalloc_free(&coroutine_alloc, co);
+    }
+    mutex_unlock(&cp_alloc_locker);
+}
+
 /**
  * 必须在用户态/或者 processor 还没有开始 run 之前初始化
  * @param p
@@ -328,13 +587,25 @@ static void coroutine_aco_init(n_processor_t *p, coroutine_t *co) {
     assert(p->main_aco.inited);
     assert(p->share_stack.sz > 0);
 
-    aco_create_init(&co->aco, &p->main_aco, &p->share_stack, 0, coroutine_wrapper, co);
+    aco_share_stack_t *stack = &p->share_stack;
+    if (costack_want(co)) {
+        aco_share_stack_t *own_stack = costack_acquire();
+        if (own_stack) {
+            stack = own_stack;
+            co->own_stack = true;
+        }
+    }
+
+    aco_create_init(&co->aco, &p->main_aco, stack, 0, coroutine_wrapper, co);
+    DEBUGF("[runtime.coroutine_aco_init] co=%p, own_stack=%d, stack=%p", co, co->own_stack, stack->ptr);
 }
 
 void processor_all_need_stop() {
+    trace_event(TRACE_STW_BEGIN, 0, 0);
     uint64_t stw_time = uv_hrtime();
     PROCESSOR_FOR(processor_list) {
         p->need_stw = stw_time;
+        rt_processor_wake(p); // park 中的 processor 需要唤醒后才能进入 stw
     }
 
     //    mutex_lock(&solo_processor_locker);
@@ -352,6 +623,7 @@ void processor_all_start() {
                 p->index,
                 (uint64_t) p->thread_id);
     }
+    trace_event(TRACE_STW_END, 0, 0);
 
     //    mutex_lock(&solo_processor_locker);
     //    PROCESSOR_FOR(solo_processor_list) {
@@ -375,74 +647,730 @@ void on_timer_stop_cb(uv_timer_t *timer) {
 }
 
 /**
- * timeout_ms 推荐 5ms ~ 10ms
+ * timeout_ms 推荐 5ms ~ 10ms, 为 0 时仅非阻塞的处理已经就绪的 io 事件
  */
 int io_run(n_processor_t *p, uint64_t timeout_ms) {
+    if (timeout_ms == 0) {
+        trace_event(TRACE_IO_BEGIN, 0, 0);
+        int result = uv_run(&p->uv_loop, UV_RUN_NOWAIT);
+        trace_event(TRACE_IO_END, 0, 0);
+        return result;
+    }
+
     // 初始化计时器 (这里不会发生栈切换，所以可以在栈上直接分配)
     p->timer.data = p;
 
     // 设置计时器超时回调，这将在超时后停止事件循环
     uv_timer_start(&p->timer, on_timer_stop_cb, timeout_ms, 0); // 只触发一次
 
-    // DEBUGF("[runtime.io_run] uv_run start, p_index=%d, loop=%p", p->index, p->uv_loop);
-    return uv_run(&p->uv_loop, UV_RUN_DEFAULT);
+    // DEBUGF("[runtime.io_run] uv_run start, p_index=%d, loop=%p", p->index, p->uv_loop);
+    trace_event(TRACE_IO_BEGIN, 0, 0);
+    int result = uv_run(&p->uv_loop, UV_RUN_DEFAULT);
+    trace_event(TRACE_IO_END, 0, 0);
+    return result;
+}
+
+/**
+ * 检测 coroutine 当前是否需要单独线程调度，如果不需要单独线程则直接在当前线程进行 aco_resume
+ */
+void coroutine_resume(n_processor_t *p, coroutine_t *co) {
+    assert(co->status == CO_STATUS_RUNNABLE && "coroutine status must be runnable");
+
+    // 首次 resume 需要进行初始化
+    if (!co->aco.inited) {
+        coroutine_aco_init(p, co);
+    }
+
+    // 将 RIP 指针移动用户代码片段中
+    RDEBUGF("[coroutine_resume] aco_resume will start,co=%p,main=%d,aco=%p, sstack=%p(%zu), p_index=%d(%d)", co,
+            co->main, &co->aco,
+            co->aco.save_stack.ptr, co->aco.save_stack.sz, p->index, p->status);
+
+    // 获取锁才能切换协程并更新状态
+    mutex_lock(&p->thread_locker);
+
+    p->coroutine = co;
+
+    // - 再 tls 中记录正在运行的协程
+    uv_key_set(&tls_coroutine_key, co);
+
+    co->p = p; // 运行前进行绑定，让 coroutine 在运行中可以准确的找到 processor
+
+    p->status = P_STATUS_RUNNABLE; // yield 返回之后才会设置 co_started_at
+
+    mutex_unlock(&p->thread_locker);
+
+    // 核心 resume
+    aco_resume(&co->aco);
+
+    TRACEF(
+            "[coroutine_resume] resume back, p_index=%d(%d), co=%p, status=%d, rt_fn=%d",
+            p->index, p->status, co, co->status, co->flag & FLAG(CO_FLAG_RTFN));
+
+    // running -> dispatch
+    assert(co->status != CO_STATUS_RUNNING);
+
+    if (co->status != CO_STATUS_DEAD) {
+        costack_observe(co);
+    }
+
+    if (co->wait_unlock_fn) {
+        co->wait_unlock_fn(co, co->wait_lock);
+        co->wait_unlock_fn = NULL;
+        co->wait_lock = NULL;
+    }
+
+    p->co_started_at = 0;
+
+    // running -> dispatch
+    // preempt -> dispatch
+    processor_set_status(p, P_STATUS_DISPATCH);
+
+    uint64_t time = (uv_hrtime() - p->co_started_at) / 1000 / 1000;
+    RDEBUGF("[coroutine_resume] resume back, co=%p, aco=%p, run_time=%lu ms, rt_co=%d", co, &co->aco, time,
+            co->flag & FLAG(CO_FLAG_RTFN));
+}
+
+/**
+ * 只有尚未 resume 过的 coroutine 才允许被窃取
+ * 已经运行过的 coroutine 的栈中可能存在指向 share_stack 的内部指针(如 rt_chan_send 中的 msg_ptr)，
+ * co_migrate 只能修正 bp 链, 所以这里不进行迁移
+ */
+static inline bool co_can_steal(coroutine_t *co) {
+    if (co->aco.inited || co->main) {
+        return false;
+    }
+
+    if (co->flag & (FLAG(CO_FLAG_SAME) | FLAG(CO_FLAG_RTFN) | FLAG(CO_FLAG_BLOCKING))) {
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * runq 已满，将 runq 中的一半连同 co 一起转移到 runq_overflow 中
+ */
+static bool runq_put_slow(n_processor_t *p, coroutine_t *co, uint32_t head, uint32_t tail) {
+    coroutine_t *batch[P_RUNQ_SIZE / 2];
+    uint32_t n = (tail - head) / 2;
+    assert(n == P_RUNQ_SIZE / 2);
+
+    for (uint32_t i = 0; i < n; ++i) {
+        batch[i] = p->runq[(head + i) & (P_RUNQ_SIZE - 1)];
+    }
+
+    // 窃取者可能同时修改了 head, 此时需要重新尝试 put
+    if (!atomic_compare_exchange_strong_explicit(&p->runq_head, &head, head + n, memory_order_acq_rel,
+                                                 memory_order_acquire)) {
+        return false;
+    }
+
+    for (uint32_t i = 0; i < n; ++i) {
+        rt_linked_fixalloc_push(&p->runq_overflow, batch[i]);
+    }
+    rt_linked_fixalloc_push(&p->runq_overflow, co);
+
+    DEBUGF("[runtime.runq_put_slow] p_index=%d, move %u coroutine to runq_overflow, overflow_count=%lu", p->index, n,
+           p->runq_overflow.count);
+    return true;
+}
+
+static void runq_put_local(n_processor_t *p, coroutine_t *co) {
+    while (true) {
+        uint32_t head = atomic_load_explicit(&p->runq_head, memory_order_acquire);
+        uint32_t tail = p->runq_tail; // 仅 owner 线程写入 tail
+        if (tail - head < P_RUNQ_SIZE) {
+            p->runq[tail & (P_RUNQ_SIZE - 1)] = co;
+            atomic_store_explicit(&p->runq_tail, tail + 1, memory_order_release);
+            return;
+        }
+
+        if (runq_put_slow(p, co, head, tail)) {
+            return;
+        }
+    }
+}
+
+/**
+ * 非 owner 线程通过 cas 将 co 推入 runq_inject 栈中, 如果 p 处于 park 状态则进行唤醒
+ */
+static void runq_inject_push(n_processor_t *p, coroutine_t *co) {
+    coroutine_t *old = atomic_load_explicit(&p->runq_inject, memory_order_relaxed);
+    do {
+        co->next = old;
+    } while (!atomic_compare_exchange_weak_explicit(&p->runq_inject, &old, co, memory_order_release,
+                                                    memory_order_relaxed));
+
+    rt_processor_wake(p);
+}
+
+/**
+ * 一次性取出 runq_inject 中的全部 coroutine, 按照推入顺序写入本地 runq
+ */
+static void runq_inject_drain(n_processor_t *p) {
+    if (atomic_load_explicit(&p->runq_inject, memory_order_relaxed) == NULL) {
+        return;
+    }
+
+    coroutine_t *list = atomic_exchange_explicit(&p->runq_inject, NULL, memory_order_acquire);
+
+    // 栈是 lifo 的，反转为 fifo
+    coroutine_t *fifo = NULL;
+    while (list) {
+        coroutine_t *next = list->next;
+        list->next = fifo;
+        fifo = list;
+        list = next;
+    }
+
+    while (fifo) {
+        coroutine_t *next = fifo->next;
+        fifo->next = NULL;
+        runq_put_local(p, fifo);
+        fifo = next;
+    }
+}
+
+static inline void runq_put_prepare(coroutine_t *co) {
+    if (co->wait_reason != TRACE_REASON_NONE) {
+        trace_event(TRACE_CO_UNBLOCK, co->id, co->wait_reason);
+        co->wait_reason = TRACE_REASON_NONE;
+    }
+
+    // 窃取迁移时保留原有的入队时间
+    if (co->runnable_at == 0) {
+        co->runnable_at = uv_hrtime();
+    }
+}
+
+static void processor_wakep(n_processor_t *self);
+
+void runq_put(n_processor_t *p, coroutine_t *co) {
+    assert(p);
+    assert(co);
+
+    runq_put_prepare(co);
+
+    if (processor_get() != p) {
+        runq_inject_push(p, co);
+        return;
+    }
+
+    runq_put_local(p, co);
+    processor_wakep(p);
+}
+
+void runq_put_next(n_processor_t *p, coroutine_t *co) {
+    assert(p);
+    assert(co);
+
+    if (processor_get() != p || p->status != P_STATUS_RUNNING) {
+        runq_put(p, co);
+        return;
+    }
+
+    runq_put_prepare(co);
+
+    // processor_handoff 可能在其他线程中同时取走 runnext, 所以使用 exchange
+    coroutine_t *old = atomic_exchange_explicit(&p->runnext, co, memory_order_acq_rel);
+    p->runnext_started_at = p->co_started_at;
+
+    if (old) {
+        runq_put_local(p, old);
+        processor_wakep(p);
+    }
+
+    TRACEF("[runtime.runq_put_next] p_index=%d, co=%p, old=%p", p->index, co, old);
+}
+
+coroutine_t *runq_get(n_processor_t *p) {
+    p->schedtick += 1;
+
+    // 只有从 runnext 中取出的 coroutine 才继承时间片
+    uint64_t inherit_at = p->runnext_started_at;
+    p->runnext_started_at = 0;
+
+    // 定期优先检查 runq_overflow, 避免 runq 持续被填满导致 overflow 中的 coroutine 饥饿
+    if (p->schedtick % P_RUNQ_OVERFLOW_TICK == 0 && p->runq_overflow.count > 0) {
+        coroutine_t *co = rt_linked_fixalloc_pop(&p->runq_overflow);
+        if (co) {
+            return co;
+        }
+    }
+
+    coroutine_t *next = atomic_load_explicit(&p->runnext, memory_order_relaxed);
+    if (next && atomic_compare_exchange_strong_explicit(&p->runnext, &next, NULL, memory_order_acq_rel,
+                                                        memory_order_relaxed)) {
+
+        // 继承的时间片已经用尽时放回 runq 尾部，避免相互唤醒的 coroutine 持续占用 processor 导致 runq 中的其他 coroutine 饥饿
+        if (inherit_at > 0 && uv_hrtime() - inherit_at >= sched_tunables.time_slice) {
+            runq_put_local(p, next);
+        } else {
+            p->runnext_started_at = inherit_at;
+            return next;
+        }
+    }
+
+    runq_inject_drain(p);
+
+    while (true) {
+        uint32_t head = atomic_load_explicit(&p->runq_head, memory_order_acquire);
+        uint32_t tail = p->runq_tail;
+        if (head == tail) {
+            break;
+        }
+
+        coroutine_t *co = p->runq[head & (P_RUNQ_SIZE - 1)];
+        if (atomic_compare_exchange_strong_explicit(&p->runq_head, &head, head + 1, memory_order_acq_rel,
+                                                    memory_order_acquire)) {
+            return co;
+        }
+    }
+
+    return rt_linked_fixalloc_pop(&p->runq_overflow);
+}
+
+/**
+ * 从 victim 的本地 runq 头部窃取连续的可迁移 coroutine, 最多窃取一半
+ */
+static int64_t runq_grab(n_processor_t *victim, coroutine_t **stolen, int64_t max) {
+    for (int retry = 0; retry < 3; ++retry) {
+        uint32_t head = atomic_load_explicit(&victim->runq_head, memory_order_acquire);
+        uint32_t tail = atomic_load_explicit(&victim->runq_tail, memory_order_acquire);
+        uint32_t n = tail - head;
+        if (n == 0) {
+            return 0;
+        }
+
+        // head 与 tail 读取不一致
+        if (n > P_RUNQ_SIZE) {
+            continue;
+        }
+
+        n = n - n / 2;
+        if (n > max) {
+            n = max;
+        }
+
+        uint32_t k = 0;
+        while (k < n) {
+            coroutine_t *co = victim->runq[(head + k) & (P_RUNQ_SIZE - 1)];
+            if (!co_can_steal(co)) {
+                break;
+            }
+            stolen[k++] = co;
+        }
+
+        if (k == 0) {
+            return 0;
+        }
+
+        if (atomic_compare_exchange_strong_explicit(&victim->runq_head, &head, head + k, memory_order_acq_rel,
+                                                    memory_order_acquire)) {
+            return k;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * victim 阻塞在 tplcall 中时使用, 逐个从 runq 头部取出 coroutine, 不可迁移的 coroutine 通过 runq_inject 放回 victim,
+ * 避免已经开始运行的 coroutine 挡住其后可迁移的 coroutine。放回的 coroutine 在 victim 返回后的 runq_get 中继续运行
+ */
+static int64_t runq_grab_skip(n_processor_t *victim, coroutine_t **stolen, int64_t max) {
+    int64_t k = 0;
+    uint32_t n = runq_local_count(victim);
+    for (uint32_t i = 0; i < n && k < max; ++i) {
+        uint32_t head = atomic_load_explicit(&victim->runq_head, memory_order_acquire);
+        uint32_t tail = atomic_load_explicit(&victim->runq_tail, memory_order_acquire);
+        if (head == tail || tail - head > P_RUNQ_SIZE) {
+            break;
+        }
+
+        coroutine_t *co = victim->runq[head & (P_RUNQ_SIZE - 1)];
+        if (!atomic_compare_exchange_strong_explicit(&victim->runq_head, &head, head + 1, memory_order_acq_rel,
+                                                     memory_order_acquire)) {
+            continue;
+        }
+
+        if (co_can_steal(co)) {
+            stolen[k++] = co;
+        } else {
+            runq_inject_push(victim, co);
+        }
+    }
+
+    return k;
+}
+
+/**
+ * 从 victim 中窃取一半可迁移的 runnable coroutine 到 p 中, 同时迁移 co_list 的归属
+ * gc_work 会无锁遍历 co_list, 所以仅在 GC_STAGE_OFF 时窃取，p 在窃取期间不会进入 stw 安全点，gc 无法在此期间推进
+ * @param handoff victim 阻塞在 tplcall 中, 跳过不可迁移的 coroutine 并且同时窃取 runnext
+ */
+static int64_t processor_steal_from(n_processor_t *p, n_processor_t *victim, bool handoff) {
+    coroutine_t *stolen[STEAL_BATCH_MAX];
+    int64_t stolen_count = 0;
+    int64_t total = runq_count(victim);
+    int64_t limit = total - total / 2;
+    if (limit > STEAL_BATCH_MAX) {
+        limit = STEAL_BATCH_MAX;
+    }
+
+    // 优先从 runq_overflow 中窃取
+    pthread_mutex_lock(&victim->runq_overflow.locker);
+    rt_linked_node_t *node = victim->runq_overflow.head;
+    while (stolen_count < limit && node != victim->runq_overflow.rear) {
+        rt_linked_node_t *succ = node->succ;
+        coroutine_t *co = node->value;
+        if (co_can_steal(co)) {
+            stolen[stolen_count++] = co;
+            rt_linked_fixalloc_remove_no_lock(&victim->runq_overflow, node);
+        }
+
+        node = succ;
+    }
+    pthread_mutex_unlock(&victim->runq_overflow.locker);
+
+    if (handoff && stolen_count < limit) {
+        coroutine_t *next = atomic_load_explicit(&victim->runnext, memory_order_relaxed);
+        if (next && co_can_steal(next) &&
+            atomic_compare_exchange_strong_explicit(&victim->runnext, &next, NULL, memory_order_acq_rel,
+                                                    memory_order_relaxed)) {
+            stolen[stolen_count++] = next;
+        }
+    }
+
+    if (stolen_count < limit) {
+        if (handoff) {
+            stolen_count += runq_grab_skip(victim, stolen + stolen_count, limit - stolen_count);
+        } else {
+            stolen_count += runq_grab(victim, stolen + stolen_count, limit - stolen_count);
+        }
+    }
+
+    if (stolen_count == 0) {
+        return 0;
+    }
+
+    // 新 dispatch 的 coroutine 位于 co_list 尾部，所以从尾部向前查找
+    pthread_mutex_lock(&victim->co_list.locker);
+    for (int64_t i = 0; i < stolen_count; ++i) {
+        rt_linked_node_t *co_node = victim->co_list.rear->prev;
+        while (co_node && co_node->value != stolen[i]) {
+            co_node = co_node->prev;
+        }
+
+        assertf(co_node, "co=%p not found in victim p_index=%d co_list", stolen[i], victim->index);
+        rt_linked_fixalloc_remove_no_lock(&victim->co_list, co_node);
+    }
+    pthread_mutex_unlock(&victim->co_list.locker);
+
+    for (int64_t i = 0; i < stolen_count; ++i) {
+        rt_linked_fixalloc_push(&p->co_list, stolen[i]);
+        runq_put(p, stolen[i]);
+    }
+
+    DEBUGF("[runtime.processor_steal_from] p_index=%d steal %ld coroutine from p_index=%d", p->index, stolen_count,
+           victim->index);
+
+    return stolen_count;
+}
+
+/**
+ * p 空闲时从 runq 最长的 processor 中窃取 coroutine, 未参与调度的 processor 不进行窃取，但其 runq 可以被窃取
+ */
+static bool processor_steal(n_processor_t *p) {
+    if (cpu_count <= 1 || gc_stage != GC_STAGE_OFF || p->need_stw > 0) {
+        return false;
+    }
+
+    if (p->index >= atomic_load(&processor_active_count)) {
+        return false;
+    }
+
+    // 优先窃取同一个 numa node 中的 processor, 避免 coroutine 迁移后跨 node 访问其栈与堆内存
+    n_processor_t *thief = p;
+    n_processor_t *victim = NULL;
+    uint64_t victim_count = 0;
+    n_processor_t *remote = NULL;
+    uint64_t remote_count = 0;
+    PROCESSOR_FOR(processor_list) {
+        if (p == thief || p->blocking) {
+            continue;
+        }
+
+        uint64_t count = runq_count(p);
+        if (p->numa_node == thief->numa_node) {
+            if (count > victim_count) {
+                victim = p;
+                victim_count = count;
+            }
+        } else if (count > remote_count) {
+            remote = p;
+            remote_count = count;
+        }
+    }
+
+    if (!victim) {
+        victim = remote;
+    }
+
+    if (!victim) {
+        return false;
+    }
+
+    return processor_steal_from(thief, victim, false) > 0;
+}
+
+/**
+ * 未参与调度的 processor 将 runq 中未开始执行的 coroutine 转移给负载最低的参与调度的 processor
+ * 已经开始执行的 coroutine 无法迁移，会继续在当前 processor 上运行直到结束
+ */
+static void processor_shed(n_processor_t *p) {
+    int64_t active_count = atomic_load(&processor_active_count);
+    if (p->index < active_count || p->blocking || gc_stage != GC_STAGE_OFF || p->need_stw > 0) {
+        return;
+    }
+
+    n_processor_t *target = NULL;
+    uint64_t target_count = 0;
+    PROCESSOR_FOR(processor_list) {
+        if (p->index >= active_count) {
+            continue;
+        }
+
+        uint64_t count = runq_count(p);
+        if (!target || count < target_count) {
+            target = p;
+            target_count = count;
+        }
+    }
+
+    if (!target) {
+        return;
+    }
+
+    while (processor_steal_from(target, p, false) > 0) {
+    }
+}
+
+/**
+ * 由 sysmon 调用, p 长时间阻塞在 tplcall 中时将其 runq(包括 runnext) 中可迁移的 coroutine 分批转移给负载最低的 processor
+ * 已经开始运行的 coroutine 的栈中可能存在指向 share_stack 的内部指针, 无法迁移, 会在 p 返回后继续运行
+ * 持有 gc_stage_locker 期间 gc 无法开始，保证 gc_work 无锁遍历 co_list 时不会发生迁移
+ * @return 转移的 coroutine 数量
+ */
+int64_t processor_handoff(n_processor_t *p) {
+    if (cpu_count <= 1) {
+        return 0;
+    }
+
+    futex_lock(&gc_stage_locker);
+    if (gc_stage != GC_STAGE_OFF || p->need_stw > 0) {
+        futex_unlock(&gc_stage_locker);
+        return 0;
+    }
+
+    int64_t active_count = atomic_load(&processor_active_count);
+    int64_t total = 0;
+    while (p->status == P_STATUS_TPLCALL) {
+        n_processor_t *blocked = p;
+        n_processor_t *target = NULL;
+        uint64_t target_count = 0;
+        PROCESSOR_FOR(processor_list) {
+            if (p == blocked || p->index >= active_count || p->status == P_STATUS_TPLCALL) {
+                continue;
+            }
+
+            uint64_t count = runq_count(p);
+            if (!target || count < target_count) {
+                target = p;
+                target_count = count;
+            }
+        }
+
+        if (!target) {
+            break;
+        }
+
+        int64_t count = processor_steal_from(target, p, true);
+        if (count == 0) {
+            break;
+        }
+        total += count;
+    }
+    futex_unlock(&gc_stage_locker);
+
+    DEBUGF("[runtime.processor_handoff] p_index=%d blocked in tplcall, handoff %ld coroutine", p->index, total);
+    return total;
+}
+
+static void on_wake_async_cb(uv_async_t *handle) {
+    // 仅用于让 uv_run 返回，runq 由 processor_run 自行处理
+}
+
+/**
+ * 空闲时自旋尝试窃取，同时自旋的 processor 数量不超过 cpu_count / 2, 避免大量空闲 processor 争抢 cpu
+ * @return 是否获取到了可运行的 coroutine
+ */
+static bool processor_spin(n_processor_t *p) {
+    int64_t active_count = atomic_load(&processor_active_count);
+    int64_t spin_max = active_count / 2;
+    if (spin_max == 0 || p->index >= active_count || atomic_load(&processor_spinning_count) >= spin_max) {
+        return false;
+    }
+
+    atomic_fetch_add(&processor_spinning_count, 1);
+
+    bool found = false;
+    for (int64_t i = 0; i < sched_tunables.spin_rounds; ++i) {
+        if (p->need_stw > 0 || main_coroutine_exited) {
+            break;
+        }
+
+        io_run(p, 0);
+        timer_wheel_run(p);
+        if (runq_count(p) > 0 || processor_steal(p)) {
+            found = true;
+            break;
+        }
+
+        sched_yield();
+    }
+
+    atomic_fetch_sub(&processor_spinning_count, 1);
+    return found;
 }
 
 /**
- * 检测 coroutine 当前是否需要单独线程调度，如果不需要单独线程则直接在当前线程进行 aco_resume
+ * 没有可运行的 coroutine 时阻塞在 uv_loop 中, 直到 io/timer 事件就绪或者被 rt_processor_wake 唤醒
  */
-void coroutine_resume(n_processor_t *p, coroutine_t *co) {
-    assert(co->status == CO_STATUS_RUNNABLE && "coroutine status must be runnable");
-
-    // 首次 resume 需要进行初始化
-    if (!co->aco.inited) {
-        coroutine_aco_init(p, co);
+static void processor_park(n_processor_t *p) {
+    atomic_store(&p->parked, true);
+    atomic_fetch_add(&processor_parked_count, 1);
+    atomic_thread_fence(memory_order_seq_cst);
+
+    // 设置 parked 之后需要重新检查, 避免丢失 park 之前推入的 coroutine 或者 stw 请求
+    if (runq_count(p) > 0 || p->need_stw > 0 || main_coroutine_exited) {
+        atomic_fetch_sub(&processor_parked_count, 1);
+        atomic_store(&p->parked, false);
+        return;
     }
 
-    // 将 RIP 指针移动用户代码片段中
-    RDEBUGF("[coroutine_resume] aco_resume will start,co=%p,main=%d,aco=%p, sstack=%p(%zu), p_index=%d(%d)", co,
-            co->main, &co->aco,
-            co->aco.save_stack.ptr, co->aco.save_stack.sz, p->index, p->status);
+    // 按照最近的定时器到期时间设置唤醒
+    timer_wheel_arm(p);
 
-    // 获取锁才能切换协程并更新状态
-    mutex_lock(&p->thread_locker);
+    uint64_t park_at = uv_hrtime();
+    trace_event(TRACE_IO_BEGIN, 0, 0);
+    uv_run(&p->uv_loop, UV_RUN_ONCE);
+    trace_event(TRACE_IO_END, 0, 0);
+    sched_hist_record(p, SCHED_HIST_IO, uv_hrtime() - park_at);
+    atomic_fetch_sub(&processor_parked_count, 1);
+    atomic_store(&p->parked, false);
+}
 
-    p->coroutine = co;
+/**
+ * 参考 go wakep, 本地 runq 推入 coroutine 时如果存在 park 的 processor 且没有 processor 正在自旋,
+ * 则唤醒其中一个, 被唤醒的 processor 会进入 processor_steal 分担 self 的积压, 否则 self 积压的
+ * coroutine 只能串行执行。存在自旋的 processor 时由其负责窃取, 避免重复唤醒
+ */
+static void processor_wakep(n_processor_t *self) {
+    // 热路径上不加 fence, 与 park 并发时可能漏掉一次唤醒, 此时 coroutine 仍由 self 执行, 只是暂时不能并行
+    if (atomic_load(&processor_parked_count) == 0 || atomic_load(&processor_spinning_count) > 0) {
+        return;
+    }
 
-    // - 再 tls 中记录正在运行的协程
-    uv_key_set(&tls_coroutine_key, co);
+    int64_t active_count = atomic_load(&processor_active_count);
+    PROCESSOR_FOR(processor_list) {
+        if (p == self || p->blocking || p->index >= active_count) {
+            continue;
+        }
 
-    co->p = p; // 运行前进行绑定，让 coroutine 在运行中可以准确的找到 processor
+        if (atomic_load(&p->parked)) {
+            // uv_async_send 是线程安全的，多次 send 会被合并
+            uv_async_send(&p->wake_async);
+            return;
+        }
+    }
+}
 
-    p->status = P_STATUS_RUNNABLE; // yield 返回之后才会设置 co_started_at
+#ifdef __LINUX
+static cpu_set_t sched_cpu_set; // 进程启动时的 cpu 亲和性, processor 只绑定到其中的 cpu
+static int sched_cpu_set_count = 0;
 
-    mutex_unlock(&p->thread_locker);
+/**
+ * 通过 /sys/devices/system/cpu/cpuN/nodeM 读取 cpu 所在的 numa node, 不需要依赖 libnuma
+ * @return 无法读取时返回 0
+ */
+static int sched_cpu_node(int cpu) {
+    char path[64];
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d", cpu);
+    DIR *dir = opendir(path);
+    if (!dir) {
+        return 0;
+    }
 
-    // 核心 resume
-    aco_resume(&co->aco);
+    int node = 0;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (strncmp(entry->d_name, "node", 4) == 0 && entry->d_name[4] >= '0' && entry->d_name[4] <= '9') {
+            node = atoi(entry->d_name + 4);
+            break;
+        }
+    }
+    closedir(dir);
 
-    TRACEF(
-            "[coroutine_resume] resume back, p_index=%d(%d), co=%p, status=%d, rt_fn=%d",
-            p->index, p->status, co, co->status, co->flag & FLAG(CO_FLAG_RTFN));
+    return node;
+}
+#endif
 
-    // running -> dispatch
-    assert(co->status != CO_STATUS_RUNNING);
+static void sched_affinity_init() {
+#ifdef __LINUX
+    CPU_ZERO(&sched_cpu_set);
+    if (sched_getaffinity(0, sizeof(sched_cpu_set), &sched_cpu_set) == 0) {
+        sched_cpu_set_count = CPU_COUNT(&sched_cpu_set);
+    }
+#endif
+}
 
-    if (co->wait_unlock_fn) {
-        co->wait_unlock_fn(co, co->wait_lock);
-        co->wait_unlock_fn = NULL;
-        co->wait_lock = NULL;
+/**
+ * 在 p 的 owner 线程中调用, 按照 index 依次绑定到亲和性中的第 index % count 个 cpu 上。
+ * 绑定后 mcache 中 span 的内存页首次访问发生在当前线程，linux 默认的 local 分配策略会在 cpu 所在的 numa node 中分配物理页
+ */
+static void processor_bind_cpu(n_processor_t *p) {
+#ifdef __LINUX
+    if (!sched_tunables.affinity || p->blocking || sched_cpu_set_count <= 0) {
+        return;
     }
 
-    p->co_started_at = 0;
+    int nth = p->index % sched_cpu_set_count;
+    int cpu = -1;
+    for (int i = 0; i < CPU_SETSIZE; ++i) {
+        if (CPU_ISSET(i, &sched_cpu_set) && nth-- == 0) {
+            cpu = i;
+            break;
+        }
+    }
 
-    // running -> dispatch
-    // preempt -> dispatch
-    processor_set_status(p, P_STATUS_DISPATCH);
+    if (cpu < 0) {
+        return;
+    }
 
-    uint64_t time = (uv_hrtime() - p->co_started_at) / 1000 / 1000;
-    RDEBUGF("[coroutine_resume] resume back, co=%p, aco=%p, run_time=%lu ms, rt_co=%d", co, &co->aco, time,
-            co->flag & FLAG(CO_FLAG_RTFN));
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    CPU_SET(cpu, &cpu_set);
+    if (sched_setaffinity(0, sizeof(cpu_set), &cpu_set) != 0) {
+        RDEBUGF("[runtime.processor_bind_cpu] p_index=%d bind cpu=%d failed: %s", p->index, cpu, strerror(errno));
+        return;
+    }
+
+    p->cpu = cpu;
+    p->numa_node = sched_cpu_node(cpu);
+    DEBUGF("[runtime.processor_bind_cpu] p_index=%d bind cpu=%d, numa_node=%d", p->index, cpu, p->numa_node);
+#endif
 }
 
 // handle by thread
@@ -464,17 +1392,24 @@ static void processor_run(void *raw) {
     // - 初始化 libuv
     uv_loop_init(&p->uv_loop);
     uv_timer_init(&p->uv_loop, &p->timer);
+    uv_async_init(&p->uv_loop, &p->wake_async, on_wake_async_cb);
+    timer_wheel_init(p);
 
     p->tls_yield_safepoint_ptr = &tls_yield_safepoint;
 
+    // main processor 直接运行在主线程中，没有经过 uv_thread_create, 异步抢占需要通过 thread_id 发送信号
+    p->thread_id = uv_thread_self();
+
     // 注册线程信号监听, 用于抢占式调度
     // 将 p 存储在线程维度全局遍历中，方便直接在 coroutine 运行中读取相关的 processor
     uv_key_set(&tls_processor_key, p);
 
+    processor_bind_cpu(p);
+
     // 对 p 进行调度处理(p 上面可能还没有 coroutine)
     while (true) {
         TRACEF("[runtime.processor_run] handle, p_index=%d, main_exited=%d, running_count=%ld", p->index, main_coroutine_exited,
-               p->runnable_list.count);
+               runq_count(p));
 
         // - stw
         if (p->need_stw > 0) {
@@ -500,16 +1435,34 @@ static void processor_run(void *raw) {
             goto EXIT;
         }
 
+        // - 处理到期的 sleep/超时定时器
+        timer_wheel_run(p);
+
+        // - 未参与调度时转移可迁移的 coroutine
+        processor_shed(p);
+
         // - 处理 coroutine (找到 io 可用的 goroutine)
-        int64_t handle_limit = 100;
-        while (p->runnable_list.count > 0 && handle_limit > 0) {
-            coroutine_t *co = rt_linked_fixalloc_pop(&p->runnable_list);
-            assert(co);
+        int64_t handle_limit = sched_tunables.handle_batch;
+        while (handle_limit > 0) {
+            coroutine_t *co = runq_get(p);
+            if (!co) {
+                break;
+            }
+
+            uint64_t resume_at = uv_hrtime();
+            if (co->runnable_at > 0) {
+                sched_hist_record(p, SCHED_HIST_WAIT, resume_at - co->runnable_at);
+                co->runnable_at = 0;
+            }
 
             RDEBUGF("[runtime.processor_run] will handle coroutine, p_index=%d, co=%p, status=%d", p->index, co,
                     co->status);
 
+            p->preempted = false;
+            trace_event(TRACE_CO_RESUME, co->id, 0);
             coroutine_resume(p, co);
+            trace_event(TRACE_CO_STOP, co->id, 0);
+            sched_hist_record(p, SCHED_HIST_RUN, uv_hrtime() - resume_at);
             handle_limit--;
 
             if (p->need_stw > 0) {
@@ -524,10 +1477,30 @@ static void processor_run(void *raw) {
 
             RDEBUGF("[runtime.processor_run] coroutine resume back, p_index=%d, co=%p",
                     p->index, co);
+
+            // 长时间运行被抢占，此时 uv_loop 中可能存在已经就绪的 io/timer 事件
+            if (p->preempted) {
+                break;
+            }
+        }
+
+        // - 本地没有可运行的 coroutine 时尝试从其他 processor 窃取
+        if (runq_count(p) == 0 && processor_steal(p)) {
+            continue;
+        }
+
+        // - 仍有可运行的 coroutine, 仅处理已经就绪的 io 事件
+        if (runq_count(p) > 0) {
+            io_run(p, 0);
+            continue;
         }
 
-        // - 处理 io 就绪事件(也就是 run 指定时间的 libuv)
-        io_run(p, WAIT_BRIEF_TIME * 5);
+        // - 空闲，自旋或者 park 等待 io 事件/唤醒
+        if (processor_spin(p)) {
+            continue;
+        }
+
+        processor_park(p);
     }
 
 EXIT:
@@ -549,6 +1522,16 @@ void rt_coroutine_dispatch(coroutine_t *co) {
     // goroutine 默认状态是 runnable
     assert(co->status == CO_STATUS_RUNNABLE);
 
+    if (co->flag & FLAG(CO_FLAG_BLOCKING)) {
+        if (sched_tunables.blocking_max > 0) {
+            blocking_dispatch(co);
+            return;
+        }
+
+        // processor index 已经被普通 processor 用尽, 没有可用的工作 processor, 退化为普通 coroutine
+        co->flag &= ~FLAG(CO_FLAG_BLOCKING);
+    }
+
     // - 遍历 shared_processor_list 找到 co_list->count 最小的 processor 进行调度
     n_processor_t *select_p = NULL;
 
@@ -557,9 +1540,19 @@ void rt_coroutine_dispatch(coroutine_t *co) {
     } else if (co->flag & FLAG(CO_FLAG_SAME)) {
         select_p = processor_get();
     } else {
+        int64_t active_count = atomic_load(&processor_active_count);
+        bool select_blocked = false;
         PROCESSOR_FOR(processor_list) {
-            if (!select_p || p->co_list.count < select_p->co_list.count) {
+            if (p->index >= active_count) {
+                continue;
+            }
+
+            // 阻塞在 c 函数中的 processor 无法及时运行新的 coroutine, 仅在没有其他选择时使用
+            bool blocked = p->status == P_STATUS_TPLCALL;
+            if (!select_p || (select_blocked && !blocked) ||
+                (select_blocked == blocked && p->co_list.count < select_p->co_list.count)) {
                 select_p = p;
+                select_blocked = blocked;
             }
         }
     }
@@ -569,11 +1562,126 @@ void rt_coroutine_dispatch(coroutine_t *co) {
            co);
 
     rt_linked_fixalloc_push(&select_p->co_list, co);
-    rt_linked_fixalloc_push(&select_p->runnable_list, co);
+    runq_put(select_p, co);
 
     DEBUGF("[runtime.rt_coroutine_dispatch] co=%p to p_index=%d, end", co, select_p->index);
 }
 
+#ifdef __LINUX
+/**
+ * 读取 cgroup 中的 cpu 配额(v2: cpu.max, v1: cpu.cfs_quota_us/cpu.cfs_period_us), 向上取整
+ * 容器中 cgroup namespace 会将当前 cgroup 挂载为 /sys/fs/cgroup, 所以这里只读取根路径
+ * @return 没有配额限制时返回 0
+ */
+static int sched_cgroup_cpu_quota() {
+    int64_t quota = -1;
+    int64_t period = 0;
+
+    FILE *f = fopen("/sys/fs/cgroup/cpu.max", "r");
+    if (f) {
+        char quota_str[32] = {0};
+        if (fscanf(f, "%31s %ld", quota_str, &period) == 2 && strcmp(quota_str, "max") != 0) {
+            quota = atoll(quota_str);
+        }
+        fclose(f);
+    } else {
+        f = fopen("/sys/fs/cgroup/cpu/cpu.cfs_quota_us", "r");
+        if (f) {
+            if (fscanf(f, "%ld", &quota) != 1) {
+                quota = -1;
+            }
+            fclose(f);
+        }
+
+        f = fopen("/sys/fs/cgroup/cpu/cpu.cfs_period_us", "r");
+        if (f) {
+            if (fscanf(f, "%ld", &period) != 1) {
+                period = 0;
+            }
+            fclose(f);
+        }
+    }
+
+    if (quota <= 0 || period <= 0) {
+        return 0;
+    }
+
+    return (int) ((quota + period - 1) / period);
+}
+#endif
+
+/**
+ * 读取正整数类型的环境变量, 超过 max 时取 max, 未设置或者不合法时返回 default_value
+ */
+static int64_t sched_env_int(char *name, int64_t default_value, int64_t max) {
+    char *env = getenv(name);
+    if (!env || env[0] == '\0') {
+        return default_value;
+    }
+
+    char *end = NULL;
+    long long value = strtoll(env, &end, 10);
+    if (*end != '\0' || value <= 0) {
+        RDEBUGF("[runtime.sched_env_int] invalid %s=%s, ignored", name, env);
+        return default_value;
+    }
+
+    return value > max ? max : value;
+}
+
+static void sched_tunables_init() {
+    int64_t slice_ms = sched_env_int(SCHED_SLICE_ENV, SCHED_TIME_SLICE, 60 * 1000);
+    int64_t default_tick = slice_ms < WAIT_SHORT_TIME ? slice_ms : WAIT_SHORT_TIME;
+    int64_t tick_ms = sched_env_int(SCHED_SYSMON_TICK_ENV, default_tick, 1000);
+
+    sched_tunables.time_slice = (uint64_t) slice_ms * 1000 * 1000;
+    sched_tunables.sysmon_tick = (uint64_t) tick_ms * 1000;
+    sched_tunables.handle_batch = sched_env_int(SCHED_BATCH_ENV, P_HANDLE_BATCH, INT32_MAX);
+    sched_tunables.spin_rounds = sched_env_int(SCHED_SPIN_ENV, P_SPIN_ROUNDS, 1024);
+    // 工作 processor 的 index 从 cpu_count 开始, 默认值同样需要限制在 PROCESSOR_MAX 以内
+    int64_t blocking_limit = PROCESSOR_MAX - cpu_count;
+    int64_t blocking_default = BLOCKING_WORKER_MAX < blocking_limit ? BLOCKING_WORKER_MAX : blocking_limit;
+    sched_tunables.blocking_max = sched_env_int(SCHED_BLOCKING_MAX_ENV, blocking_default, blocking_limit);
+    sched_tunables.affinity = sched_env_int(SCHED_AFFINITY_ENV, 0, 1) == 1;
+
+    DEBUGF("[runtime.sched_tunables_init] time_slice=%lu ms, sysmon_tick=%lu ms, handle_batch=%ld, spin_rounds=%ld, blocking_max=%ld, affinity=%d",
+           slice_ms, tick_ms, sched_tunables.handle_batch, sched_tunables.spin_rounds, sched_tunables.blocking_max,
+           sched_tunables.affinity);
+}
+
+/**
+ * 计算默认的 processor 数量
+ * 优先使用环境变量 NATURE_PROCS, 否则取 cpu 数量、线程 cpu 亲和性与 cgroup cpu 配额中的最小值
+ */
+static int sched_processor_count() {
+    int64_t env_count = sched_env_int(PROCESSOR_COUNT_ENV, 0, PROCESSOR_MAX);
+    if (env_count > 0) {
+        return (int) env_count;
+    }
+
+    uv_cpu_info_t *info;
+    int count = 0;
+    uv_cpu_info(&info, &count);
+    uv_free_cpu_info(info, count);
+
+#ifdef __LINUX
+    if (sched_cpu_set_count > 0 && sched_cpu_set_count < count) {
+        count = sched_cpu_set_count;
+    }
+
+    int quota_count = sched_cgroup_cpu_quota();
+    if (quota_count > 0 && quota_count < count) {
+        count = quota_count;
+    }
+#endif
+
+    if (count <= 0) {
+        count = 1;
+    }
+
+    return count > PROCESSOR_MAX ? PROCESSOR_MAX : count;
+}
+
 /**
  * 各种全局变量初始化都通过该方法
  */
@@ -585,17 +1693,32 @@ void sched_init() {
     uv_key_create(&tls_processor_key);
     uv_key_create(&tls_coroutine_key);
 
-    // - 读取当前 cpu 线程数初始化相应数量的 p
-    uv_cpu_info_t *info;
-    uv_cpu_info(&info, &cpu_count);
-    uv_free_cpu_info(info, cpu_count);
+    // - 读取 processor 数量初始化相应数量的 p
+    sched_affinity_init();
+    cpu_count = sched_processor_count();
+    processor_active_count = cpu_count;
+
+    // - 读取调度参数
+    sched_tunables_init();
+
+    costack_init();
+
+    blocking_init();
+
+    // - NATURE_TRACE 开启时从启动开始记录调度事件
+    trace_init();
+
+    // - NATURE_BLOCKPROF_RATE 开启时从启动开始记录阻塞事件
+    blockprof_init();
 
     // - 初始化全局标识
     gc_barrier = false;
-    mutex_init(&gc_stage_locker, false);
+    futex_locker_init(&gc_stage_locker);
     //    mutex_init(&solo_processor_locker, false);
     gc_stage = GC_STAGE_OFF;
     coroutine_count = 0;
+    processor_spinning_count = 0;
+    processor_parked_count = 0;
 
     // - libuv 线程锁
     uv_loop_init(&uv_global_loop);
@@ -605,6 +1728,14 @@ void sched_init() {
     mutex_init(&global_linkco_locker, false);
     global_linkco_cache = NULL;
 
+    for (int i = 0; i < FUTURE_LOCKER_COUNT; ++i) {
+        mutex_init(&future_lockers[i], false);
+    }
+
+    // - 初始化 pool 列表
+    mutex_init(&pool_list_locker, false);
+    pool_list = NULL;
+
     rt_linked_fixalloc_init(&global_gc_worklist);
 
     // - 初始化 processor 和 coroutine 分配器
@@ -614,9 +1745,15 @@ void sched_init() {
 
     DEBUGF("[runtime.sched_init] cpu_count=%d", cpu_count);
 
+    // 常驻 gc 控制线程与 mark worker
+    gc_controller_init();
+
     // 全局信号监控
     signal_init();
 
+    // 异步抢占信号
+    preempt_signal_init();
+
     // - 为每一个 processor 创建对应的 thread 进行处理对应的 p
     // 初始化 share_processor_index 数组为 0
     processor_list = NULL;
@@ -631,6 +1768,26 @@ void sched_init() {
     }
 }
 
+void processor_spawn(n_processor_t *p) {
+    rt_linked_fixalloc_init(&p->gc_worklist);
+    p->gc_work_finished = memory->gc_count;
+    processor_index[p->index] = p;
+
+    // 追加到 processor_list 尾部，scan_global 使用的 processor_list 头部保持不变
+    n_processor_t *last = processor_list;
+    while (last->next) {
+        last = last->next;
+    }
+    atomic_thread_fence(memory_order_release);
+    last->next = p;
+
+    if (uv_thread_create(&p->thread_id, processor_run, p) != 0) {
+        assert(false && "pthread_create failed");
+    }
+
+    DEBUGF("[runtime.processor_spawn] processor run, index=%d, blocking=%d", p->index, p->blocking);
+}
+
 void sched_run() {
     // index 0 是 main processor, 直接使用当前主线程运行
     for (int i = 1; i < cpu_count; ++i) {
@@ -740,10 +1897,8 @@ void mark_ptr_black(void *value) {
  * @return
  */
 coroutine_t *rt_coroutine_new(void *fn, int64_t flag, n_future_t *fu, void *arg) {
-    mutex_lock(&cp_alloc_locker);
-    coroutine_t *co = fixalloc_alloc(&coroutine_alloc);
-    co->id = coroutine_count++;
-    mutex_unlock(&cp_alloc_locker);
+    coroutine_t *co = coroutine_alloc_cached(processor_get());
+    co->id = atomic_fetch_add(&coroutine_count, 1);
 
     if (in_heap((addr_t) fn)) {
         rt_shade_obj_with_barrier(fn);
@@ -769,14 +1924,25 @@ coroutine_t *rt_coroutine_new(void *fn, int64_t flag, n_future_t *fu, void *arg)
     co->status = CO_STATUS_RUNNABLE;
     co->p = NULL;
     co->next = NULL;
+    co->preempt_ret_addr = 0;
+    co->runnable_at = 0;
+    co->wait_reason = TRACE_REASON_NONE;
+    co->own_stack = false;
+    co->switch_count = 0;
+    co->stack_depth_max = 0;
     co->aco.inited = 0; // 标记为为初始化
 
+    trace_event(TRACE_CO_CREATE, co->id, 0);
+
     return co;
 }
 
 // 如果被抢占会导致全局队列卡死，所以 linked 和 processor 绑定好了, 这就关系到 fixalloc_t 的释放问题
 // 除非在这期间不进行抢占，
 n_processor_t *processor_new(int index) {
+    // processor_index 与 rt_pool locals 等按照 index 索引的数组长度都是 PROCESSOR_MAX
+    assertf(index >= 0 && index < PROCESSOR_MAX, "processor index=%d out of range", index);
+
     mutex_lock(&cp_alloc_locker);
     n_processor_t *p = fixalloc_alloc(&processor_alloc);
     mutex_unlock(&cp_alloc_locker);
@@ -795,26 +1961,59 @@ n_processor_t *processor_new(int index) {
     p->co_started_at = 0;
     p->mcache.flush_gen = 0; // 线程维度缓存，避免内存分配锁
     rt_linked_fixalloc_init(&p->co_list);
-    rt_linked_fixalloc_init(&p->runnable_list);
+    rt_linked_fixalloc_init(&p->runq_overflow);
+    p->runq_head = 0;
+    p->runq_tail = 0;
+    p->runq_inject = NULL;
+    p->runnext = NULL;
+    p->runnext_started_at = 0;
+    p->schedtick = 0;
+    p->parked = false;
+    p->preempted = false;
     p->index = index;
     p->next = NULL;
+    p->cpu = -1;
+    p->numa_node = 0;
 
     p->linkco_count = 0;
+    p->co_cache = NULL;
+    p->co_cache_count = 0;
+    memset(p->save_stack_cache, 0, sizeof(p->save_stack_cache));
+    memset(p->save_stack_cache_count, 0, sizeof(p->save_stack_cache_count));
 
     return p;
 }
 
 void coroutine_free(coroutine_t *co) {
-    mutex_lock(&cp_alloc_locker);
-
+    aco_save_stack_t save_stack = co->aco.save_stack;
     aco_destroy(&co->aco);
+    if (co->own_stack) {
+        costack_release(co->aco.share_stack);
+        co->own_stack = false;
+    }
     co->id = 0;
     co->fn = NULL;
     co->aco.save_stack.ptr = 0;
     co->status = CO_STATUS_DEAD;
 
-    fixalloc_free(&coroutine_alloc, co);
-    mutex_unlock(&cp_alloc_locker);
+    // gc_work 在 co 所属的 processor 中释放 coroutine, 此时归还到本地缓存
+    n_processor_t *p = processor_get();
+    if (!p) {
+        mutex_lock(&cp_alloc_locker);
+        fixalloc_free(&coroutine_alloc, co);
+        mutex_unlock(&cp_alloc_locker);
+        return;
+    }
+
+    save_stack_release(save_stack.ptr, save_stack.sz);
+
+    if (p->co_cache_count >= P_CO_CACHE_MAX) {
+        coroutine_cache_spill(p);
+    }
+
+    co->next = p->co_cache;
+    p->co_cache = co;
+    p->co_cache_count++;
 }
 
 /**
@@ -829,9 +2028,13 @@ void processor_free(n_processor_t *p) {
     coroutine_t *co = rt_linked_fixalloc_pop(&p->co_list);
     coroutine_free(co);
 
+    while (p->co_cache) {
+        coroutine_cache_spill(p);
+    }
+
     aco_share_stack_destroy(&p->share_stack);
     rt_linked_fixalloc_free(&p->co_list);
-    rt_linked_fixalloc_free(&p->runnable_list);
+    rt_linked_fixalloc_free(&p->runq_overflow);
     aco_destroy(&p->main_aco);
 
     // 归还 mcache span
@@ -873,6 +2076,14 @@ bool processor_all_safe() {
             continue;
         }
 
+        // 阻塞在 c 函数中的 p 不会访问 gc 相关的数据, post_tplcall_hook 会等待 stw 结束后再返回用户代码
+        mutex_lock(&p->thread_locker);
+        bool in_tplcall = p->status == P_STATUS_TPLCALL;
+        mutex_unlock(&p->thread_locker);
+        if (in_tplcall) {
+            continue;
+        }
+
         RDEBUGF(
                 "[runtime_gc.processor_all_safe] share processor p_index=%d, thread_id=%lu not safe, need_stw=%lu, safe_point=%lu",
                 p->index, (uint64_t) p->thread_id, p->need_stw, p->in_stw);
@@ -1043,6 +2254,7 @@ void processor_set_status(n_processor_t *p, p_status_t status) {
     //    }
 
     p->status = status;
+    trace_event(TRACE_P_STATUS, p->coroutine ? p->coroutine->id : 0, status);
 
     //    if (!p->share && status == P_STATUS_RUNNING) {
     //        mutex_unlock(&p->gc_solo_stw_locker);
@@ -1051,8 +2263,50 @@ void processor_set_status(n_processor_t *p, p_status_t status) {
     mutex_unlock(&p->thread_locker);
 
     if (status == P_STATUS_RUNNING) {
-        p->co_started_at = uv_hrtime();
+        processor_slice_start(p);
+    }
+}
+
+void pre_tplcall_hook() {
+    n_processor_t *p = processor_get();
+    if (!p || p->status != P_STATUS_RUNNING) {
+        return;
+    }
+
+    // tplcall 期间 co_started_at 记录进入 c 函数的时间，sysmon 基于该时间判断是否需要转移 runq
+    p->co_started_at = uv_hrtime();
+    processor_set_status(p, P_STATUS_TPLCALL);
+}
+
+void post_tplcall_hook() {
+    n_processor_t *p = processor_get();
+    if (!p || p->status != P_STATUS_TPLCALL) {
+        return;
+    }
+
+    // 调用方需要读取 c 函数设置的 errno
+    int saved_errno = errno;
+    while (true) {
+        // 与 processor_all_safe 配对, 持有 thread_locker 时读取到的 need_stw 为 0 才能回到 running
+        mutex_lock(&p->thread_locker);
+        if (p->need_stw == 0) {
+            p->status = P_STATUS_RUNNING;
+            trace_event(TRACE_P_STATUS, p->coroutine ? p->coroutine->id : 0, P_STATUS_RUNNING);
+            mutex_unlock(&p->thread_locker);
+            break;
+        }
+        mutex_unlock(&p->thread_locker);
+
+        // gc 已经将 p 视为安全点，需要等待 stw 结束后才能返回用户代码
+        DEBUGF("[runtime.post_tplcall_hook] p_index=%d need stw, wait stw end, need_stw=%lu", p->index, p->need_stw);
+        p->in_stw = p->need_stw;
+        while (processor_need_stw(p)) {
+            usleep(WAIT_BRIEF_TIME * 1000);
+        }
     }
+
+    p->co_started_at = uv_hrtime();
+    errno = saved_errno;
 }
 
 void rt_coroutine_return(void *result_ptr) {
@@ -1067,33 +2321,177 @@ void rt_coroutine_return(void *result_ptr) {
            *(int64_t *) co->future->result, co->future->size);
 }
 
-void rt_coroutine_await(coroutine_t *target_co) {
-    mutex_lock(&target_co->dead_locker);
+/**
+ * target_co 退出时会在 future_locker 中将 future->co 置空，之后才会被 gc 回收复用,
+ * 所以加锁后 future->co 不为空时可以确认 target_co 尚未退出
+ */
+void rt_coroutine_await(n_future_t *future) {
+    if (!future->co) {
+        return;
+    }
+
+    mutex_t *locker = future_locker(future);
+    mutex_lock(locker);
     coroutine_t *src_co = coroutine_get();
-    if (target_co->status == CO_STATUS_DEAD) {
-        mutex_unlock(&target_co->dead_locker);
+    coroutine_t *target_co = future->co;
+    if (!target_co || target_co->status == CO_STATUS_DEAD) {
+        mutex_unlock(locker);
         return;
     }
     target_co->await_co = src_co;
     co_set_status(src_co->p, src_co, CO_STATUS_WAITING);
-    mutex_unlock(&target_co->dead_locker);
+    src_co->wait_reason = TRACE_REASON_AWAIT;
+    trace_event(TRACE_CO_BLOCK, src_co->id, TRACE_REASON_AWAIT);
+    mutex_unlock(locker);
 
     // 一旦 unlock 就可能会发生 runnable push 以及 status set, 但是不影响当前 yield
+    uint64_t block_start = blockprof_start();
     _co_yield(src_co->p, src_co);
+    blockprof_end(block_start, TRACE_REASON_AWAIT);
 
     // waiting -> syscall
     co_set_status(src_co->p, src_co, CO_STATUS_TPLCALL);
 }
 
+/**
+ * 将 group 绑定到 future 对应的 coroutine 中, 并在 future_locker 中为 pending 增加 delta
+ * @return future 对应的 coroutine 已经退出时返回 false
+ */
+static bool await_group_add(await_group_t *group, n_future_t *future, int64_t delta) {
+    if (!future->co) {
+        return false;
+    }
+
+    mutex_t *locker = future_locker(future);
+    mutex_lock(locker);
+    coroutine_t *target_co = future->co;
+    if (!target_co || target_co->status == CO_STATUS_DEAD) {
+        mutex_unlock(locker);
+        return false;
+    }
+
+    await_group_node_t *node = mallocz(sizeof(await_group_node_t));
+    node->group = group;
+    node->next = target_co->await_groups;
+    target_co->await_groups = node;
+    atomic_fetch_add(&group->pending, delta);
+    mutex_unlock(locker);
+    return true;
+}
+
+/**
+ * 释放注册期间持有的计数, pending 未归零时 park 当前 coroutine, 直到被最后一个退出的 coroutine 唤醒
+ */
+static void await_group_wait(await_group_t *group) {
+    coroutine_t *src_co = group->waiter;
+    co_set_status(src_co->p, src_co, CO_STATUS_WAITING);
+    if (atomic_fetch_sub(&group->pending, 1) == 1) {
+        co_set_status(src_co->p, src_co, CO_STATUS_TPLCALL);
+        return;
+    }
+
+    src_co->wait_reason = TRACE_REASON_AWAIT;
+    trace_event(TRACE_CO_BLOCK, src_co->id, TRACE_REASON_AWAIT);
+
+    // 与 rt_coroutine_await 一致, fetch_sub 之后就可能发生 runnable push, 但是不影响当前 yield
+    uint64_t block_start = blockprof_start();
+    _co_yield(src_co->p, src_co);
+    blockprof_end(block_start, TRACE_REASON_AWAIT);
+
+    co_set_status(src_co->p, src_co, CO_STATUS_TPLCALL);
+}
+
+void rt_coroutine_await_all(n_vec_t *futures) {
+    await_group_t *group = mallocz(sizeof(await_group_t));
+    group->pending = 1;
+    group->waiter = coroutine_get();
+
+    n_future_t **list = (n_future_t **) futures->data;
+    for (int64_t i = 0; i < futures->length; ++i) {
+        await_group_add(group, list[i], 1);
+    }
+
+    DEBUGF("[runtime.rt_coroutine_await_all] co=%p, futures=%ld, pending=%ld", group->waiter, futures->length,
+           group->pending);
+    await_group_wait(group);
+
+    // pending 归零说明所有 coroutine 都已经完成了对 group 的访问
+    free(group);
+}
+
+int64_t rt_coroutine_await_any(n_vec_t *futures) {
+    if (futures->length == 0) {
+        return -1;
+    }
+
+    // 注册期间的计数 + 第一个退出的 coroutine 的计数
+    await_group_t *group = mallocz(sizeof(await_group_t));
+    group->pending = 2;
+    group->waiter = coroutine_get();
+    group->any = true;
+
+    n_future_t **list = (n_future_t **) futures->data;
+    int64_t added = 0;
+    bool done = false;
+    for (; added < futures->length; ++added) {
+        if (!await_group_add(group, list[added], 0)) {
+            done = true;
+            break;
+        }
+    }
+
+    if (!done) {
+        await_group_wait(group);
+    }
+
+    // 解除尚未退出的 coroutine 与 group 的绑定, 已经退出的 coroutine 在 future->co 置空之前就完成了对 group 的访问
+    for (int64_t i = 0; i < added; ++i) {
+        if (!list[i]->co) {
+            continue;
+        }
+
+        mutex_t *locker = future_locker(list[i]);
+        mutex_lock(locker);
+        coroutine_t *target_co = list[i]->co;
+        if (target_co) {
+            await_group_node_t **link = &target_co->await_groups;
+            while (*link) {
+                await_group_node_t *node = *link;
+                if (node->group == group) {
+                    *link = node->next;
+                    free(node);
+                } else {
+                    link = &node->next;
+                }
+            }
+        }
+        mutex_unlock(locker);
+    }
+    free(group);
+
+    for (int64_t i = 0; i < futures->length; ++i) {
+        if (!list[i]->co) {
+            DEBUGF("[runtime.rt_coroutine_await_any] co=%p, done index=%ld", coroutine_get(), i);
+            return i;
+        }
+    }
+
+    assert(false && "await_any wakeup without completed future");
+    return -1;
+}
+
 void rt_processor_wake(n_processor_t *p) {
     n_processor_t *current_p = processor_get();
     if (current_p == p) {
         return;
     }
 
-    if (p->runnable_list.count != 1) {
+    // 与 processor_park 中的 parked 写入与 runq 检查配对
+    atomic_thread_fence(memory_order_seq_cst);
+    if (!atomic_load(&p->parked)) {
         return;
     }
 
-    uv_stop(&p->uv_loop);
+    // uv_async_send 是线程安全的，多次 send 会被合并
+    uv_async_send(&p->wake_async);
 }
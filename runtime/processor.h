@@ -2,25 +2,56 @@
 #define NATURE_PROCESSOR_H
 
 #include <include/uv.h>
+#include <stdatomic.h>
 #include <stdint.h>
 
 #include "linkco.h"
 #include "nutils/errort.h"
 #include "nutils/vec.h"
 #include "runtime.h"
+#include "trace.h"
+#include "blockprof.h"
 
 #define GC_STW_WAIT_COUNT 25
 #define GC_STW_SWEEP_COUNT (GC_STW_WAIT_COUNT * 2)
 
-extern int cpu_count;
-extern n_processor_t *processor_index[1024];
+#define STEAL_BATCH_MAX 128 // 单次最多窃取的 coroutine 数量
+
+#define PREEMPT_SIGNAL SIGURG // 异步抢占信号
+#define PREEMPT_HIJACK_DEPTH 64 // 异步抢占时沿 rbp 链查找 nature fn 返回地址的最大深度
+
+#define PROCESSOR_MAX 1024 // processor_index 的容量
+#define FUTURE_LOCKER_COUNT 256 // await 与 coroutine 退出同步使用的分段锁数量, 必须是 2 的幂
+#define PROCESSOR_COUNT_ENV "NATURE_PROCS" // 通过环境变量指定 processor 数量
+
+#define SCHED_SLICE_ENV "NATURE_SCHED_SLICE" // coroutine 时间片, 单位 ms
+#define SCHED_SYSMON_TICK_ENV "NATURE_SYSMON_TICK" // sysmon 监控间隔, 单位 ms, 默认 min(10, 时间片)
+#define SCHED_BATCH_ENV "NATURE_SCHED_BATCH" // 单轮调度最多 resume 的 coroutine 数量
+#define SCHED_SPIN_ENV "NATURE_SCHED_SPIN" // 空闲 processor park 之前自旋窃取的轮次
+#define SCHED_BLOCKING_MAX_ENV "NATURE_BLOCKING_MAX" // run_blocking 工作线程数量上限
+#define SCHED_AFFINITY_ENV "NATURE_AFFINITY" // 设置为 1 时将 processor 线程绑定到进程 cpu 亲和性中的 cpu 上(仅 linux)
+
+typedef struct {
+    uint64_t time_slice; // 单位 ns, 超过该时间的 coroutine 会被 sysmon 抢占
+    uint64_t sysmon_tick; // 单位 us
+    int64_t handle_batch;
+    int64_t spin_rounds;
+    int64_t blocking_max;
+    bool affinity;
+} sched_tunables_t;
+
+extern sched_tunables_t sched_tunables; // sched_init 时从环境变量中读取, 之后只读
+
+extern int cpu_count; // 已经创建的 processor 数量
+extern ATOMIC int64_t processor_active_count; // 参与调度的 processor 数量，index >= 该值的 processor 不再接收新的 coroutine
+extern n_processor_t *processor_index[PROCESSOR_MAX];
 extern n_processor_t *processor_list; // 共享协程列表的数量一般就等于线程数量
 
 //extern n_processor_t *solo_processor_list; // 独享协程列表其实就是多线程
 extern bool main_coroutine_exited;
 
 //extern mutex_t solo_processor_locker; // 删除 solo processor 需要先获取该锁
-extern int64_t coroutine_count;
+extern ATOMIC int64_t coroutine_count;
 extern uv_key_t tls_processor_key;
 extern uv_key_t tls_coroutine_key;
 
@@ -49,6 +80,8 @@ typedef enum {
     CO_FLAG_SAME = 2,
     CO_FLAG_MAIN = 3,
     CO_FLAG_RTFN = 4, // runtime_fn 不需要扫描 stack
+    CO_FLAG_OWN_STACK = 5, // 使用独立栈，切换时不需要拷贝栈
+    CO_FLAG_BLOCKING = 6, // 在 run_blocking 工作线程中运行，不占用 processor
 } co_flag_t;
 
 #ifdef __LINUX
@@ -82,6 +115,15 @@ static inline void co_set_status(n_processor_t *p, coroutine_t *co, co_status_t
     co->status = status;
 }
 
+/**
+ * coroutine 开始或者继续运行时记录时间片的开始时间，从 runnext 中取出的 coroutine 继承唤醒方剩余的时间片
+ */
+static inline void processor_slice_start(n_processor_t *p) {
+    uint64_t inherit_at = p->runnext_started_at;
+    p->runnext_started_at = 0;
+    p->co_started_at = inherit_at > 0 ? inherit_at : uv_hrtime();
+}
+
 /**
  * yield 统一入口, 避免直接调用 aco_yield
  */
@@ -93,13 +135,79 @@ static inline void _co_yield(n_processor_t *p, coroutine_t *co) {
 
     // yield 返回，继续 running
     p->status = P_STATUS_RUNNING;
-    p->co_started_at = uv_hrtime();
+    processor_slice_start(p);
+}
+
+/**
+ * 将 co 推送到 p 的可运行队列中，owner 线程直接写入本地 runq, 其他线程通过 runq_inject 无锁推入
+ */
+void runq_put(n_processor_t *p, coroutine_t *co);
+
+/**
+ * 正在运行的 coroutine 唤醒 co 时调用, co 与当前 coroutine 位于同一个 processor 时放入 runnext 中,
+ * 当前 coroutine 让出后 co 立即运行并继承剩余的时间片，runnext 中原有的 coroutine 放回 runq 尾部。
+ * 其他情况与 runq_put 一致
+ */
+void runq_put_next(n_processor_t *p, coroutine_t *co);
+
+/**
+ * 仅允许 p 的 owner 线程调用
+ */
+coroutine_t *runq_get(n_processor_t *p);
+
+/**
+ * 仅允许 p 的 owner 线程调用
+ * @param duration 单位 ns
+ */
+static inline void sched_hist_record(n_processor_t *p, sched_hist_kind_t kind, uint64_t duration) {
+    sched_hist_t *hist = &p->sched_hist[kind];
+    uint64_t us = duration / 1000;
+    int bucket = us == 0 ? 0 : 64 - __builtin_clzll(us);
+    if (bucket >= SCHED_HIST_BUCKETS) {
+        bucket = SCHED_HIST_BUCKETS - 1;
+    }
+
+    hist->count += 1;
+    hist->sum += duration;
+    hist->buckets[bucket] += 1;
+}
+
+static inline uint32_t runq_local_count(n_processor_t *p) {
+    // 先读取 head, tail 只会增长，所以 tail - head 不会溢出
+    uint32_t head = atomic_load_explicit(&p->runq_head, memory_order_acquire);
+    uint32_t tail = atomic_load_explicit(&p->runq_tail, memory_order_acquire);
+    return tail - head;
+}
+
+/**
+ * 近似值，仅用于 sysmon/spin/steal 等启发式判断
+ */
+static inline uint64_t runq_count(n_processor_t *p) {
+    uint64_t count = runq_local_count(p) + p->runq_overflow.count;
+    if (atomic_load_explicit(&p->runq_inject, memory_order_relaxed) != NULL) {
+        count += 1;
+    }
+
+    if (atomic_load_explicit(&p->runnext, memory_order_relaxed) != NULL) {
+        count += 1;
+    }
+
+    return count;
 }
 
 static inline void co_ready(coroutine_t *co) {
     assert(co->p->status != P_STATUS_EXIT);
     co_set_status(co->p, co, CO_STATUS_RUNNABLE);
-    rt_linked_fixalloc_push(&co->p->runnable_list, co);
+    runq_put(co->p, co);
+}
+
+/**
+ * 由正在运行的 coroutine 唤醒 co(chan/mutex/await), co 会在当前 coroutine 让出后优先运行
+ */
+static inline void co_ready_next(coroutine_t *co) {
+    assert(co->p->status != P_STATUS_EXIT);
+    co_set_status(co->p, co, CO_STATUS_RUNNABLE);
+    runq_put_next(co->p, co);
 }
 
 static inline void co_yield_runnable(n_processor_t *p, coroutine_t *co) {
@@ -109,7 +217,8 @@ static inline void co_yield_runnable(n_processor_t *p, coroutine_t *co) {
 
     // syscall -> runnable
     co_set_status(p, co, CO_STATUS_RUNNABLE);
-    rt_linked_fixalloc_push(&p->runnable_list, co);
+    trace_event(TRACE_CO_YIELD, co->id, TRACE_REASON_NONE);
+    runq_put(p, co);
 
     DEBUGF("[runtime.co_yield_runnable] p_index=%d, co=%p, co_status=%d, will yield", p->index, co,
            co->status);
@@ -130,6 +239,12 @@ static inline void co_yield_waiting(coroutine_t *co, unlock_fn unlock_fn, void *
     co->wait_unlock_fn = unlock_fn;
     co->wait_lock = lock_of;
 
+    // 调用方没有指定 wait_reason 时都是在等待 uv_loop 中的 io/timer 事件
+    if (co->wait_reason == TRACE_REASON_NONE) {
+        co->wait_reason = TRACE_REASON_IO;
+    }
+    trace_event(TRACE_CO_BLOCK, co->id, co->wait_reason);
+
     // 这里作为一个整体，不再允许抢占
     // syscall -> waiting
     co_set_status(co->p, co, CO_STATUS_WAITING);
@@ -178,8 +293,26 @@ void sched_run();
 
 n_processor_t *processor_new(int index);
 
+/**
+ * 运行期间将 processor_new 创建的 p 加入 processor_list 并启动对应的线程
+ * 调用方需要持有 gc_stage_locker 并且 gc_stage == GC_STAGE_OFF, 保证加入期间不会发生 stw
+ */
+void processor_spawn(n_processor_t *p);
+
 void coroutine_free(coroutine_t *co);
 
+/**
+ * 按照 size class 申请 save_stack, 不超过 CO_SAVE_STACK_CACHE_MAX 时优先从 processor 本地缓存中获取
+ * save_stack 不包含 gc 指针, scan_stack 基于 fndef 精确扫描, 所以总是通过 noscan span 申请
+ * @param sz 需要的最小空间, 返回时更新为 size class 的大小
+ */
+void *save_stack_alloc(size_t *sz);
+
+/**
+ * 将不再使用的 save_stack 归还到 processor 本地缓存, 缓存已满或者超过 CO_SAVE_STACK_CACHE_MAX 时交给 gc 回收
+ */
+void save_stack_release(void *ptr, size_t sz);
+
 void processor_free(n_processor_t *p);
 
 /**
@@ -210,7 +343,18 @@ void co_migrate(aco_t *aco, aco_share_stack_t *new_st);
 
 void rt_coroutine_sleep(int64_t ms);
 
-void rt_coroutine_await(coroutine_t *co);
+void rt_coroutine_await(n_future_t *future);
+
+/**
+ * 等待 futures 中所有的 coroutine 退出, 调用方只会 park 一次
+ */
+void rt_coroutine_await_all(n_vec_t *futures);
+
+/**
+ * 等待 futures 中任意一个 coroutine 退出
+ * @return 已经完成的 future 的 index, futures 为空时返回 -1
+ */
+int64_t rt_coroutine_await_any(n_vec_t *futures);
 
 void rt_coroutine_yield();
 
@@ -220,6 +364,30 @@ void *rt_coroutine_arg();
 
 int64_t rt_processor_index();
 
+int64_t rt_processor_count();
+
+/**
+ * 调整参与调度的 processor 数量, 范围为 [1, cpu_count], n <= 0 时不做调整
+ * @return 调整前的数量
+ */
+int64_t rt_processor_set_count(int64_t n);
+
+/**
+ * 读取调度延迟直方图, p_index < 0 时汇总所有 processor
+ * @return [count, sum_ns, buckets...], 长度为 SCHED_HIST_BUCKETS + 2
+ */
+n_vec_t *rt_sched_histogram(int64_t kind, int64_t p_index);
+
+void processor_preempt_signal(n_processor_t *p);
+
+/**
+ * 将长时间阻塞在 tplcall 中的 p 的 runq 转移给其他 processor, 仅由 sysmon 调用
+ */
+int64_t processor_handoff(n_processor_t *p);
+
+/**
+ * 唤醒 park 在 uv_loop 中的 p, 可以在任意线程中调用
+ */
 void rt_processor_wake(n_processor_t *p);
 
 // ------------ libuv 的一些回调 -----------------------
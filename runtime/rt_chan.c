@@ -2,6 +2,8 @@
 
 #include <stdatomic.h>
 
+#define SELECT_STACK_CASES 16 // 不超过该数量的 case 时 pollorder/lockorder 使用栈空间
+
 typedef struct {
     n_chan_t *chan;
     void *msg_ptr;
@@ -9,42 +11,87 @@ typedef struct {
 
 static void selunlock(scase *cases, int16_t *lockorder, int16_t norder);
 
-static inline bool buf_empty(n_chan_t *ch) {
-    return ch->buf_front == ch->buf_rear;
+static inline uint64_t *buf_seq(n_chan_t *ch, uint64_t pos) {
+    return (uint64_t *) ch->buf_seqs->data + (pos & ch->buf_mask);
 }
 
-static inline bool buf_full(n_chan_t *ch) {
-    if (ch->buf->length == 0) {
-        return true;
-    }
-    return ((ch->buf_rear + 1) % ch->buf->length) == ch->buf_front;
+static inline void *buf_element_addr(n_chan_t *ch, uint64_t pos) {
+    return ch->buf->data + (pos & ch->buf_mask) * ch->buf->element_size;
 }
 
 /**
- * 从队列头部取出元素
+ * 无锁写入 buf 尾部, 槽位序号等于 pos 时表示可写，cas buf_rear 占用槽位后写入数据，最后将序号更新为 pos + 1
+ * @return buf 已满(或者槽位中的数据正在被读取)时返回 false
  */
-static inline void buf_pop(n_chan_t *ch, void *msg_ptr) {
-    assert(!buf_empty(ch));
+static bool buf_push(n_chan_t *ch, void *msg_ptr) {
+    uint64_t pos = atomic_load_explicit(&ch->buf_rear, memory_order_relaxed);
+    while (true) {
+        uint64_t front = atomic_load_explicit(&ch->buf_front, memory_order_acquire);
+        if ((int64_t) (pos - front) >= (int64_t) ch->buf_cap) {
+            return false;
+        }
 
-    if (msg_ptr) {
-        rti_vec_access(ch->buf, ch->buf_front, msg_ptr);
+        uint64_t seq = atomic_load_explicit(buf_seq(ch, pos), memory_order_acquire);
+        int64_t diff = (int64_t) (seq - pos);
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&ch->buf_rear, &pos, pos + 1, memory_order_relaxed,
+                                                      memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            return false;
+        } else {
+            pos = atomic_load_explicit(&ch->buf_rear, memory_order_relaxed);
+        }
     }
 
-    ch->buf_front = (ch->buf_front + 1) % ch->buf->capacity;
+    memmove(buf_element_addr(ch, pos), msg_ptr, ch->msg_size);
+    atomic_store_explicit(buf_seq(ch, pos), pos + 1, memory_order_release);
+    return true;
 }
 
 /**
- * 获取 可以 push 的 element ptr
+ * 无锁读取 buf 头部, 槽位序号等于 pos + 1 时表示可读，读取完成后将序号更新为 pos + buf 长度供下一轮写入
+ * @return buf 为空(或者槽位中的数据正在被写入)时返回 false
  */
-static void *buf_next_ref(n_chan_t *ch) {
-    assert(!buf_full(ch));
+static bool buf_pop(n_chan_t *ch, void *msg_ptr) {
+    uint64_t pos = atomic_load_explicit(&ch->buf_front, memory_order_relaxed);
+    while (true) {
+        uint64_t seq = atomic_load_explicit(buf_seq(ch, pos), memory_order_acquire);
+        int64_t diff = (int64_t) (seq - (pos + 1));
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&ch->buf_front, &pos, pos + 1, memory_order_relaxed,
+                                                      memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            return false;
+        } else {
+            pos = atomic_load_explicit(&ch->buf_front, memory_order_relaxed);
+        }
+    }
 
-    void *ele_addr = (void *) rt_vec_element_addr(ch->buf, ch->buf_rear);
-    ch->buf_rear = (ch->buf_rear + 1) % ch->buf->length;
+    if (msg_ptr) {
+        memmove(msg_ptr, buf_element_addr(ch, pos), ch->msg_size);
+    }
+    atomic_store_explicit(buf_seq(ch, pos), pos + ch->buf_mask + 1, memory_order_release);
+    return true;
+}
 
-    return ele_addr;
+static inline bool buf_readable(n_chan_t *ch) {
+    uint64_t pos = atomic_load_explicit(&ch->buf_front, memory_order_acquire);
+    return atomic_load_explicit(buf_seq(ch, pos), memory_order_acquire) == pos + 1;
 }
 
+static inline bool buf_writable(n_chan_t *ch) {
+    uint64_t pos = atomic_load_explicit(&ch->buf_rear, memory_order_acquire);
+    uint64_t front = atomic_load_explicit(&ch->buf_front, memory_order_acquire);
+    if ((int64_t) (pos - front) >= (int64_t) ch->buf_cap) {
+        return false;
+    }
+
+    return atomic_load_explicit(buf_seq(ch, pos), memory_order_acquire) == pos;
+}
 
 static inline bool waitq_empty(waitq_t *waitq) {
     assert(waitq);
@@ -185,6 +232,61 @@ static bool chan_yield_commit(coroutine_t *co, void *chan_lock) {
     return true;
 }
 
+static inline void chan_ready_list_push(linkco_t **head, linkco_t **rear, linkco_t *linkco) {
+    if (*rear) {
+        (*rear)->next = linkco;
+    } else {
+        *head = linkco;
+    }
+    *rear = linkco;
+}
+
+/**
+ * 唤醒 chan_ready_list_push 串联的 coroutine, co 唤醒后可能立即释放 linkco, 所以需要先读取 next
+ */
+static inline void chan_ready_list_wake(linkco_t *head) {
+    while (head) {
+        linkco_t *next = head->next;
+        head->next = NULL;
+        co_ready_next(head->co);
+        head = next;
+    }
+}
+
+/**
+ * 有缓冲的 chan 中 sendq/recvq 里的 coroutine 只用于等待通知, 不直接传递数据，被唤醒后重新尝试读写 buf。
+ * buf 读写成功之后调用，与等待方 "入队 -> 重新检查 buf" 配对(seq_cst), 避免丢失唤醒
+ * 批量读写时一次加锁最多唤醒 count 个等待者
+ */
+static void chan_wake_waiters(n_chan_t *chan, waitq_t *waitq, int64_t count) {
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&waitq->head, memory_order_relaxed) == NULL) {
+        return;
+    }
+
+    // 弹出的 linkco 通过 next 串联，解锁之后再唤醒
+    linkco_t *head = NULL;
+    linkco_t *rear = NULL;
+    pthread_mutex_lock(&chan->lock);
+    for (int64_t i = 0; i < count; ++i) {
+        linkco_t *linkco = waitq_pop(waitq);
+        if (!linkco) {
+            break;
+        }
+
+        linkco->success = true;
+        linkco->co->data = linkco;
+        chan_ready_list_push(&head, &rear, linkco);
+    }
+    pthread_mutex_unlock(&chan->lock);
+
+    chan_ready_list_wake(head);
+}
+
+static inline void chan_wake_waiter(n_chan_t *chan, waitq_t *waitq) {
+    chan_wake_waiters(chan, waitq, 1);
+}
+
 n_chan_t *rt_chan_new(int64_t rhash, int64_t ele_rhash, int64_t buf_len) {
     assertf(rhash > 0, "rhash must be a valid hash");
     assertf(ele_rhash > 0, "ele_rhash must be a valid hash");
@@ -198,8 +300,26 @@ n_chan_t *rt_chan_new(int64_t rhash, int64_t ele_rhash, int64_t buf_len) {
     chan->msg_size = rtype_stack_size(element_rtype, POINTER_SIZE);
     pthread_mutex_init(&chan->lock, NULL);
 
+    // buf 长度向上取整到 2 的幂，通过 & buf_mask 计算索引, 可用容量依旧是 buf_len
+    uint64_t size = 0;
+    if (buf_len > 0) {
+        size = 1;
+        while (size < (uint64_t) buf_len) {
+            size <<= 1;
+        }
+    }
+
     // ele_rhash
-    chan->buf = rti_vec_new(element_rtype, buf_len, buf_len);
+    chan->buf = rti_vec_new(element_rtype, (int64_t) size, (int64_t) size);
+    chan->buf_cap = buf_len > 0 ? buf_len : 0;
+    chan->buf_mask = size > 0 ? size - 1 : 0;
+    if (size > 0) {
+        chan->buf_seqs = rti_vec_new(&uint64_rtype, (int64_t) size, (int64_t) size);
+        for (uint64_t i = 0; i < size; ++i) {
+            *buf_seq(chan, i) = i;
+        }
+    }
+
     return chan;
 }
 
@@ -219,7 +339,69 @@ static void rt_send(n_chan_t *chan, linkco_t *linkco, void *msg_ptr, scase *case
     } else {
         pthread_mutex_unlock(&chan->lock);
     }
-    co_ready(co);
+    co_ready_next(co);
+}
+
+/**
+ * 有缓冲的 chan, buf 未满时无锁写入，已满时加锁进入 sendq 等待 recv 唤醒后重试
+ */
+static bool chan_buf_send(n_chan_t *chan, void *msg_ptr, bool try) {
+    while (true) {
+        if (chan->closed) {
+            rti_throw("send on closed channel", false);
+            return false;
+        }
+
+        if (buf_push(chan, msg_ptr)) {
+            chan_wake_waiter(chan, &chan->recvq);
+            return true;
+        }
+
+        if (try) {
+            return false;
+        }
+
+        pthread_mutex_lock(&chan->lock);
+        if (chan->closed) {
+            rti_throw("send on closed channel", false);
+            pthread_mutex_unlock(&chan->lock);
+            return false;
+        }
+
+        coroutine_t *co = coroutine_get();
+        linkco_t *linkco = rti_acquire_linkco();
+        linkco->co = co;
+        linkco->data = msg_ptr;
+        linkco->is_select = false;
+        linkco->chan = chan;
+        co->waiting = linkco;
+        waitq_push(&chan->sendq, linkco);
+
+        // 入队之后重新检查, 入队前 recv 读取了 buf 但没有看到 sendq 中的 linkco
+        atomic_thread_fence(memory_order_seq_cst);
+        if (buf_push(chan, msg_ptr)) {
+            waitq_remove(&chan->sendq, linkco);
+            pthread_mutex_unlock(&chan->lock);
+
+            co->waiting = NULL;
+            rti_release_linkco(linkco);
+            chan_wake_waiter(chan, &chan->recvq);
+            return true;
+        }
+
+        DEBUGF("[rt_chan_send] buf full, will yield to waiting")
+        assert(co->wait_unlock_fn == NULL);
+        co->wait_reason = TRACE_REASON_CHAN;
+        uint64_t block_start = blockprof_start();
+        co_yield_waiting(co, chan_yield_commit, &chan->lock);
+        blockprof_end(block_start, TRACE_REASON_CHAN);
+        assertf(linkco == co->waiting, "coroutine waiting list is corrupted");
+
+        co->waiting = NULL;
+        co->data = NULL;
+        linkco->chan = NULL;
+        rti_release_linkco(linkco);
+    }
 }
 
 /**
@@ -228,6 +410,10 @@ static void rt_send(n_chan_t *chan, linkco_t *linkco, void *msg_ptr, scase *case
  * @param msg_ptr
  */
 bool rt_chan_send(n_chan_t *chan, void *msg_ptr, bool try) {
+    if (chan->buf_cap > 0) {
+        return chan_buf_send(chan, msg_ptr, try);
+    }
+
     pthread_mutex_lock(&chan->lock);
 
     if (chan->closed) {
@@ -242,26 +428,11 @@ bool rt_chan_send(n_chan_t *chan, void *msg_ptr, bool try) {
         return true;
     }
 
-    if (!buf_full(chan)) {
-        // 直接将 msg push 到 chan 中, 不阻塞当前 buf
-        void *dst_ptr = buf_next_ref(chan);
-
-        memmove(dst_ptr, msg_ptr, chan->msg_size);
-
-        pthread_mutex_unlock(&chan->lock);
-        return true;
-    }
     if (try) {
         pthread_mutex_unlock(&chan->lock);
         return false;
     }
 
-    if (chan->closed) {
-        rti_throw("send on closed channel", false);
-        pthread_mutex_unlock(&chan->lock);
-        return false;
-    }
-
     // 直接将自身 yield 并等待 recv 唤醒
     DEBUGF("[rt_chan_send] recvq empty,  will yield to waiting")
     coroutine_t *co = coroutine_get();
@@ -278,7 +449,10 @@ bool rt_chan_send(n_chan_t *chan, void *msg_ptr, bool try) {
     waitq_push(&chan->sendq, linkco);
 
     assert(co->wait_unlock_fn == NULL);
+    co->wait_reason = TRACE_REASON_CHAN;
+    uint64_t block_start = blockprof_start();
     co_yield_waiting(co, chan_yield_commit, &chan->lock);
+    blockprof_end(block_start, TRACE_REASON_CHAN);
     assertf(linkco == co->waiting, "coroutine waiting list is corrupted");
 
     co->waiting = NULL;
@@ -297,23 +471,13 @@ bool rt_chan_send(n_chan_t *chan, void *msg_ptr, bool try) {
     return true;
 }
 
+/**
+ * 仅用于无缓冲 chan, 直接从 sendq 中的 coroutine 栈中读取数据
+ */
 static void rt_recv(n_chan_t *chan, linkco_t *linkco, void *msg_ptr, scase *cases, int16_t *lockorder, int16_t norder) {
     assert(msg_ptr);
-    if (buf_empty(chan)) {
-        DEBUGF("[rt_chan_recv] sendq have, buf empty,  will direct wakeup")
-        rt_msg_transmit(linkco->co, linkco->data, msg_ptr, false, chan->msg_size);
-    } else {
-        assert(buf_full(chan));
-
-        // 直接将缓冲区中的数据 pop 到 msg 中，然后将 sendq 中的数据 push 到尾部。
-        assert(msg_ptr);
-
-        buf_pop(chan, msg_ptr);
-
-        // copy linkco->data to buf tail
-        void *dst_ptr = buf_next_ref(chan);
-        rt_msg_transmit(linkco->co, linkco->data, dst_ptr, false, chan->msg_size);
-    }
+    assert(chan->buf_cap == 0);
+    rt_msg_transmit(linkco->co, linkco->data, msg_ptr, false, chan->msg_size);
 
     linkco->data = NULL;
     coroutine_t *co = linkco->co; // ready co
@@ -327,7 +491,68 @@ static void rt_recv(n_chan_t *chan, linkco_t *linkco, void *msg_ptr, scase *case
     co->data = linkco;
     linkco->success = true;
 
-    co_ready(co);
+    co_ready_next(co);
+}
+
+/**
+ * 有缓冲的 chan, buf 不为空时无锁读取，为空时加锁进入 recvq 等待 send 唤醒后重试
+ */
+static bool chan_buf_recv(n_chan_t *chan, void *msg_ptr, bool try) {
+    while (true) {
+        if (buf_pop(chan, msg_ptr)) {
+            chan_wake_waiter(chan, &chan->sendq);
+            return true;
+        }
+
+        if (try) {
+            return false;
+        }
+
+        pthread_mutex_lock(&chan->lock);
+        coroutine_t *co = coroutine_get();
+        linkco_t *linkco = rti_acquire_linkco();
+        linkco->co = co;
+        linkco->data = msg_ptr;
+        linkco->waitlink = NULL;
+        linkco->is_select = false;
+        linkco->chan = chan;
+        co->waiting = linkco;
+        co->data = NULL;
+        waitq_push(&chan->recvq, linkco);
+
+        // 入队之后重新检查, 入队前 send 写入了 buf 但没有看到 recvq 中的 linkco
+        atomic_thread_fence(memory_order_seq_cst);
+        bool received = buf_pop(chan, msg_ptr);
+        if (received || chan->closed) {
+            waitq_remove(&chan->recvq, linkco);
+            pthread_mutex_unlock(&chan->lock);
+
+            co->waiting = NULL;
+            linkco->chan = NULL;
+            rti_release_linkco(linkco);
+
+            if (!received) {
+                rti_throw("recv on closed channel", false);
+                return false;
+            }
+
+            chan_wake_waiter(chan, &chan->sendq);
+            return true;
+        }
+
+        DEBUGF("[rt_chan_recv] buf empty, will yield to waiting")
+        assert(co->wait_unlock_fn == NULL);
+        co->wait_reason = TRACE_REASON_CHAN;
+        uint64_t block_start = blockprof_start();
+        co_yield_waiting(co, chan_yield_commit, &chan->lock);
+        blockprof_end(block_start, TRACE_REASON_CHAN);
+        assert(linkco == co->waiting);
+
+        co->waiting = NULL;
+        co->data = NULL;
+        linkco->chan = NULL;
+        rti_release_linkco(linkco);
+    }
 }
 
 /**
@@ -337,6 +562,10 @@ static void rt_recv(n_chan_t *chan, linkco_t *linkco, void *msg_ptr, scase *case
  * @param try
  */
 bool rt_chan_recv(n_chan_t *chan, void *msg_ptr, bool try) {
+    if (chan->buf_cap > 0) {
+        return chan_buf_recv(chan, msg_ptr, try);
+    }
+
     pthread_mutex_lock(&chan->lock);
 
     linkco_t *linkco = waitq_pop(&chan->sendq);
@@ -345,14 +574,6 @@ bool rt_chan_recv(n_chan_t *chan, void *msg_ptr, bool try) {
         return true;
     }
 
-    if (!buf_empty(chan)) {
-        assert(waitq_empty(&chan->sendq));
-        buf_pop(chan, msg_ptr);
-
-        pthread_mutex_unlock(&chan->lock);
-        return true;
-    }
-
     // no buf no sendq
     if (try) {
         pthread_mutex_unlock(&chan->lock);
@@ -379,7 +600,10 @@ bool rt_chan_recv(n_chan_t *chan, void *msg_ptr, bool try) {
     waitq_push(&chan->recvq, linkco);
 
     assert(co->wait_unlock_fn == NULL);
+    co->wait_reason = TRACE_REASON_CHAN;
+    uint64_t block_start = blockprof_start();
     co_yield_waiting(co, chan_yield_commit, &chan->lock);
+    blockprof_end(block_start, TRACE_REASON_CHAN);
 
     assert(linkco == co->waiting);
     co->waiting = NULL;
@@ -393,6 +617,163 @@ bool rt_chan_recv(n_chan_t *chan, void *msg_ptr, bool try) {
     return true;
 }
 
+static inline void *chan_vec_element_addr(n_vec_t *vec, int64_t index) {
+    return vec->data + index * vec->element_size;
+}
+
+/**
+ * 不阻塞地写入 msgs[start:], 有缓冲时写入 buf 之后一次性唤醒 recvq 中对应数量的等待者,
+ * 无缓冲时在一次加锁中将数据依次交给 recvq 中等待的 coroutine
+ * @return 写入的数量, chan closed 时抛出异常并返回 -1
+ */
+static int64_t chan_send_batch(n_chan_t *chan, n_vec_t *msgs, int64_t start) {
+    int64_t n = 0;
+    if (chan->buf_cap > 0) {
+        if (chan->closed) {
+            rti_throw("send on closed channel", false);
+            return -1;
+        }
+
+        while (start + n < msgs->length && buf_push(chan, chan_vec_element_addr(msgs, start + n))) {
+            n += 1;
+        }
+
+        if (n > 0) {
+            chan_wake_waiters(chan, &chan->recvq, n);
+        }
+        return n;
+    }
+
+    pthread_mutex_lock(&chan->lock);
+    if (chan->closed) {
+        rti_throw("send on closed channel", false);
+        pthread_mutex_unlock(&chan->lock);
+        return -1;
+    }
+
+    linkco_t *head = NULL;
+    linkco_t *rear = NULL;
+    while (start + n < msgs->length) {
+        linkco_t *linkco = waitq_pop(&chan->recvq);
+        if (!linkco) {
+            break;
+        }
+
+        if (linkco->data) {
+            rt_msg_transmit(linkco->co, linkco->data, chan_vec_element_addr(msgs, start + n), true, chan->msg_size);
+            linkco->data = NULL;
+        }
+        linkco->success = true;
+        linkco->co->data = linkco;
+        chan_ready_list_push(&head, &rear, linkco);
+        n += 1;
+    }
+    pthread_mutex_unlock(&chan->lock);
+
+    chan_ready_list_wake(head);
+    return n;
+}
+
+/**
+ * 不阻塞地读取最多 max - start 条消息到 list[start:] 中, 与 chan_send_batch 对应
+ */
+static int64_t chan_recv_batch(n_chan_t *chan, n_vec_t *list, int64_t start, int64_t max) {
+    int64_t n = 0;
+    if (chan->buf_cap > 0) {
+        while (start + n < max && buf_pop(chan, chan_vec_element_addr(list, start + n))) {
+            n += 1;
+            list->length = start + n;
+        }
+
+        if (n > 0) {
+            chan_wake_waiters(chan, &chan->sendq, n);
+        }
+        return n;
+    }
+
+    pthread_mutex_lock(&chan->lock);
+    linkco_t *head = NULL;
+    linkco_t *rear = NULL;
+    while (start + n < max) {
+        linkco_t *linkco = waitq_pop(&chan->sendq);
+        if (!linkco) {
+            break;
+        }
+
+        rt_msg_transmit(linkco->co, linkco->data, chan_vec_element_addr(list, start + n), false, chan->msg_size);
+        linkco->data = NULL;
+        linkco->success = true;
+        linkco->co->data = linkco;
+        chan_ready_list_push(&head, &rear, linkco);
+        n += 1;
+        list->length = start + n;
+    }
+    pthread_mutex_unlock(&chan->lock);
+
+    chan_ready_list_wake(head);
+    return n;
+}
+
+/**
+ * 按顺序发送 msgs 中的全部消息，能够立即写入的部分批量写入, 剩余的消息通过 rt_chan_send 阻塞发送,
+ * 被唤醒之后继续批量写入
+ */
+void rt_chan_send_many(n_chan_t *chan, n_vec_t *msgs) {
+    assert(msgs->element_size == chan->msg_size);
+
+    int64_t i = 0;
+    while (i < msgs->length) {
+        int64_t n = chan_send_batch(chan, msgs, i);
+        if (n < 0) {
+            return;
+        }
+
+        i += n;
+        if (i == msgs->length) {
+            break;
+        }
+
+        // 无缓冲 chan 的接收方通过 rt_msg_transmit 读取发送方的栈地址，所以需要先复制到当前栈中
+        uint8_t msg[chan->msg_size];
+        memmove(msg, chan_vec_element_addr(msgs, i), chan->msg_size);
+        if (!rt_chan_send(chan, msg, false)) {
+            return;
+        }
+        i += 1;
+    }
+
+    DEBUGF("[rt_chan_send_many] chan=%p, sent=%ld", chan, i);
+}
+
+/**
+ * 读取 1 ~ max 条消息到 list 中(list 容量不小于 max), 没有可读取的消息时阻塞等待第一条消息,
+ * 之后不再阻塞，读取已经就绪的部分
+ */
+void rt_chan_recv_many(n_chan_t *chan, n_vec_t *list, int64_t max) {
+    assert(list->element_size == chan->msg_size);
+    assert(list->capacity >= max);
+
+    list->length = 0;
+    if (max <= 0) {
+        rti_throw("recv_many max must be greater than 0", false);
+        return;
+    }
+
+    int64_t n = chan_recv_batch(chan, list, 0, max);
+    if (n == 0) {
+        uint8_t msg[chan->msg_size];
+        if (!rt_chan_recv(chan, msg, false)) {
+            return;
+        }
+
+        memmove(chan_vec_element_addr(list, 0), msg, chan->msg_size);
+        list->length = 1;
+        n = 1 + chan_recv_batch(chan, list, 1, max);
+    }
+
+    DEBUGF("[rt_chan_recv_many] chan=%p, received=%ld", chan, n);
+}
+
 void rt_chan_close(n_chan_t *chan) {
     if (chan->closed) {
         rti_throw("chan already closed", false);
@@ -455,6 +836,162 @@ static bool selpark_commit(coroutine_t *co, void *arg) {
     return true;
 }
 
+/**
+ * 持有所有 chan 锁时调用, 检查有缓冲的 chan 是否已经可以读写
+ */
+static bool selbuf_ready(scase *cases, int16_t sends_count, int16_t cases_count) {
+    for (int16_t i = 0; i < cases_count; i++) {
+        n_chan_t *c = cases[i].chan;
+        if (c->buf_cap == 0) {
+            continue;
+        }
+
+        if (i < sends_count ? buf_writable(c) : buf_readable(c)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * 持有所有 chan 锁时调用, 将 pass 2 中入队的 linkco 全部移除
+ */
+static void selunqueue(coroutine_t *co, scase *cases, int16_t sends_count, int16_t cases_count) {
+    linkco_t *lc = co->waiting;
+    for (int16_t i = 0; i < cases_count; i++) {
+        assert(lc);
+        linkco_t *next = lc->waitlink;
+        if (i < sends_count) {
+            waitq_remove(&cases[i].chan->sendq, lc);
+        } else {
+            waitq_remove(&cases[i].chan->recvq, lc);
+        }
+
+        lc->waitlink = NULL;
+        lc->is_select = false;
+        lc->data = NULL;
+        lc->chan = NULL;
+        rti_release_linkco(lc);
+        lc = next;
+    }
+
+    co->waiting = NULL;
+}
+
+/**
+ * 不持有 select 的全部锁, 单独尝试一个 case, 语义与 pass 1 中的同一个 case 一致
+ * 有缓冲的 chan 直接无锁读写 buf; 无缓冲的 chan 先无锁观察 waitq 与 closed, 看起来就绪时仅锁定该 chan 再次确认
+ * @return case 已经完成(包括 chan closed)时返回 true
+ */
+static bool selcase_try(scase *cas, bool is_send) {
+    n_chan_t *c = cas->chan;
+    linkco_t *lc = NULL;
+
+    if (is_send) {
+        if (c->closed != 0) {
+            c->successful = false;
+            return true;
+        }
+
+        if (c->buf_cap > 0) {
+            if (buf_push(c, cas->msg_ptr)) {
+                chan_wake_waiter(c, &c->recvq);
+                return true;
+            }
+
+            return false;
+        }
+
+        if (atomic_load_explicit(&c->recvq.head, memory_order_relaxed) == NULL) {
+            return false;
+        }
+
+        pthread_mutex_lock(&c->lock);
+        if (c->closed != 0) {
+            pthread_mutex_unlock(&c->lock);
+            c->successful = false;
+            return true;
+        }
+
+        lc = waitq_pop(&c->recvq);
+        if (lc == NULL) {
+            pthread_mutex_unlock(&c->lock);
+            return false;
+        }
+
+        rt_send(c, lc, cas->msg_ptr, NULL, NULL, 0);
+        return true;
+    }
+
+    // recv
+    if (c->buf_cap > 0) {
+        if (buf_pop(c, cas->msg_ptr)) {
+            chan_wake_waiter(c, &c->sendq);
+            return true;
+        }
+
+        if (c->closed != 0) {
+            c->successful = false;
+            return true;
+        }
+
+        return false;
+    }
+
+    if (atomic_load_explicit(&c->sendq.head, memory_order_relaxed) == NULL && c->closed == 0) {
+        return false;
+    }
+
+    pthread_mutex_lock(&c->lock);
+    lc = waitq_pop(&c->sendq);
+    if (lc != NULL) {
+        rt_recv(c, lc, cas->msg_ptr, NULL, NULL, 0);
+        return true;
+    }
+
+    bool closed = c->closed != 0;
+    pthread_mutex_unlock(&c->lock);
+    if (closed) {
+        c->successful = false;
+    }
+
+    return closed;
+}
+
+/**
+ * select 快速路径, 按照 pollorder 依次尝试每个 case, 存在就绪的 case 时不需要排序 lockorder 与锁定所有 chan
+ * @return 完成的 case index, 没有就绪的 case 时返回 -1
+ */
+static int16_t selfast(scase *cases, int16_t *pollorder, int16_t pollorder_count, int16_t sends_count) {
+    for (int16_t i = 0; i < pollorder_count; i++) {
+        int16_t casi = pollorder[i];
+        if (selcase_try(&cases[casi], casi < sends_count)) {
+            return casi;
+        }
+    }
+
+    return -1;
+}
+
+/**
+ * 单个 case + default 的 select 由编译器直接 lower 为 try send, 不需要构造 scase 数组
+ * @return 0 表示 case 被选中(包括 chan closed), -1 表示选择 default 分支
+ */
+int rt_chan_select_try_send(n_chan_t *chan, void *msg_ptr) {
+    scase cas = {.chan = chan, .msg_ptr = msg_ptr};
+    return selcase_try(&cas, true) ? 0 : -1;
+}
+
+/**
+ * 单个 case + default 的 select 由编译器直接 lower 为 try recv
+ * @return 0 表示 case 被选中(包括 chan closed), -1 表示选择 default 分支
+ */
+int rt_chan_select_try_recv(n_chan_t *chan, void *msg_ptr) {
+    scase cas = {.chan = chan, .msg_ptr = msg_ptr};
+    return selcase_try(&cas, false) ? 0 : -1;
+}
+
 /**
  * 返回 cases index, 如果 default 分支被选中则返回 -1
  * @param cases
@@ -468,7 +1005,13 @@ int rt_chan_select(scase *cases, int16_t sends_count, int16_t recvs_count, bool
     DEBUGF("[rt_chan_select] cases = %p, sends_count = %d, recvs_count = %d", cases, sends_count, recvs_count);
 
     int16_t cases_count = sends_count + recvs_count;
-    int16_t *order = mallocz(sizeof(int16_t) * cases_count * 2);
+
+    // case 数量较少时 pollorder/lockorder 直接使用栈空间
+    int16_t order_buf[SELECT_STACK_CASES * 2] = {0};
+    int16_t *order = order_buf;
+    if (cases_count > SELECT_STACK_CASES) {
+        order = mallocz(sizeof(int16_t) * cases_count * 2);
+    }
     int16_t *pollorder = order;
     int16_t *lockorder = order + cases_count;
 
@@ -487,6 +1030,16 @@ int rt_chan_select(scase *cases, int16_t sends_count, int16_t recvs_count, bool
         pollorder_count++;
     }
 
+    // 唤醒当前 select 的有缓冲 chan, 重新 poll 后选中了其他 case 时需要将唤醒转交给该 chan 的其他等待者
+    n_chan_t *woken_chan = NULL;
+    bool woken_send = false;
+
+    // 按照 pollorder 无锁尝试一轮, 存在就绪的 case 时直接返回
+    int16_t casi = selfast(cases, pollorder, pollorder_count, sends_count);
+    if (casi >= 0 || _try) {
+        goto RETC;
+    }
+
     // 生成 lockorder by chan address
     for (int16_t i = 0; i < cases_count; i++) {
         int16_t j = i;
@@ -530,26 +1083,28 @@ int rt_chan_select(scase *cases, int16_t sends_count, int16_t recvs_count, bool
 
     linkco_t *lc = NULL;
 
-    // pass 1 - look for something already waiting
-    int16_t casi = 0;
+    // pass 1 - look for something already waiting, 按照 pollorder 遍历保证公平
     scase *cas = NULL;
     bool case_success = false;
     n_chan_t *c = NULL;
-    for (int16_t i = 0; i < cases_count; i++) {
-        casi = i;
+POLL:
+    for (int16_t i = 0; i < pollorder_count; i++) {
+        casi = pollorder[i];
         cas = &cases[casi];
         c = cas->chan;
         assert(c);
 
         if (casi >= sends_count) {
-            // recv
-            lc = waitq_pop(&c->sendq);
-            if (lc != NULL) {
-                goto RECV;
-            }
-
-            if (!buf_empty(c)) {
-                goto BUFRECV;
+            // recv, 有缓冲的 chan 的 sendq 中不存在可以直接读取的数据
+            if (c->buf_cap > 0) {
+                if (buf_pop(c, cas->msg_ptr)) {
+                    goto BUFRECV;
+                }
+            } else {
+                lc = waitq_pop(&c->sendq);
+                if (lc != NULL) {
+                    goto RECV;
+                }
             }
 
             if (c->closed != 0) {
@@ -561,13 +1116,15 @@ int rt_chan_select(scase *cases, int16_t sends_count, int16_t recvs_count, bool
                 goto SCLOSE;
             }
 
-            lc = waitq_pop(&c->recvq);
-            if (lc != NULL) {
-                goto SEND;
-            }
-
-            if (!buf_full(c)) {
-                goto BUFSEND;
+            if (c->buf_cap > 0) {
+                if (buf_push(c, cas->msg_ptr)) {
+                    goto BUFSEND;
+                }
+            } else {
+                lc = waitq_pop(&c->recvq);
+                if (lc != NULL) {
+                    goto SEND;
+                }
             }
         }
     }
@@ -578,7 +1135,8 @@ int rt_chan_select(scase *cases, int16_t sends_count, int16_t recvs_count, bool
         goto RETC;
     }
 
-    // pass 2 - enqueue on all chans
+    // pass 2 - enqueue on all chans, 此时没有任何 case 就绪, 之前的唤醒已经没有需要转交的数据或空位
+    woken_chan = NULL;
     coroutine_t *co = coroutine_get();
     assert(co->waiting == NULL);
 
@@ -608,9 +1166,19 @@ int rt_chan_select(scase *cases, int16_t sends_count, int16_t recvs_count, bool
         }
     }
 
+    // 入队之后重新检查有缓冲的 chan, 入队前无锁的 send/recv 可能已经读写了 buf 但没有看到 linkco
+    atomic_thread_fence(memory_order_seq_cst);
+    if (selbuf_ready(cases, sends_count, cases_count)) {
+        selunqueue(co, cases, sends_count, cases_count);
+        goto POLL;
+    }
+
     co->data = NULL;
     // yield
+    co->wait_reason = TRACE_REASON_SELECT;
+    uint64_t block_start = blockprof_start();
     co_yield_waiting(co, selpark_commit, NULL);
+    blockprof_end(block_start, TRACE_REASON_SELECT);
     DEBUGF("[rt_chan_select] co wakeup, will return, casi=%d", casi);
 
     // sellock
@@ -665,6 +1233,13 @@ int rt_chan_select(scase *cases, int16_t sends_count, int16_t recvs_count, bool
 
     c = cas->chan;
 
+    // 有缓冲的 chan 仅通知 buf 可以读写, 需要重新 poll
+    if (c->buf_cap > 0) {
+        woken_chan = c;
+        woken_send = casi < sends_count;
+        goto POLL;
+    }
+
     if (casi < sends_count) {
         if (!case_success) {
             goto SCLOSE;
@@ -676,15 +1251,14 @@ int rt_chan_select(scase *cases, int16_t sends_count, int16_t recvs_count, bool
 
     BUFRECV:
     case_success = true;
-    buf_pop(c, cas->msg_ptr);
     selunlock(cases, lockorder, cases_count);
+    chan_wake_waiter(c, &c->sendq);
     goto RETC;
 
     BUFSEND:
     case_success = true;
-    void *dst_ptr = buf_next_ref(c);
-    memmove(dst_ptr, cas->msg_ptr, c->msg_size);
     selunlock(cases, lockorder, cases_count);
+    chan_wake_waiter(c, &c->recvq);
     goto RETC;
 
     RECV:
@@ -710,11 +1284,15 @@ int rt_chan_select(scase *cases, int16_t sends_count, int16_t recvs_count, bool
     goto RETC;
 
     RETC:
-    if (casi >= 0) {
-
+    // chan_wake_waiter 每次只唤醒一个等待者, 如果 select 最终没有读写唤醒它的 chan, 需要继续唤醒下一个等待者,
+    // 否则 buf 中的数据(或空位)会一直保留, 阻塞在同一个 chan 上的 send/recv 不会再被唤醒
+    if (woken_chan && (casi < 0 || cases[casi].chan != woken_chan || (casi < sends_count) != woken_send)) {
+        chan_wake_waiter(woken_chan, woken_send ? &woken_chan->sendq : &woken_chan->recvq);
     }
 
-    free(order);
+    if (order != order_buf) {
+        free(order);
+    }
     DEBUGF("[rt_chan_select] return casi=%d", casi);
     return casi;
 }
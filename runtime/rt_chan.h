@@ -12,6 +12,10 @@ bool rt_chan_send(n_chan_t *chan, void *msg_ptr, bool try);
 
 bool rt_chan_recv(n_chan_t *chan, void *msg_ptr, bool try);
 
+void rt_chan_send_many(n_chan_t *chan, n_vec_t *msgs);
+
+void rt_chan_recv_many(n_chan_t *chan, n_vec_t *list, int64_t max);
+
 void rt_chan_close(n_chan_t *chan);
 
 bool rt_chan_is_closed(n_chan_t *chan);
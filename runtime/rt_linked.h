@@ -123,15 +123,9 @@ static inline rt_linked_node_t *rt_linked_fixalloc_first(rt_linked_fixalloc_t *l
     return result;
 }
 
-static inline void rt_linked_fixalloc_remove(rt_linked_fixalloc_t *l, rt_linked_node_t *node) {
-    if (node == NULL) {
-        return;
-    }
-
-    pthread_mutex_lock(&l->locker);
+static inline void rt_linked_fixalloc_remove_no_lock(rt_linked_fixalloc_t *l, rt_linked_node_t *node) {
     if (node == l->head) {
         rt_linked_fixalloc_pop_no_lock(l);
-        pthread_mutex_unlock(&l->locker);
         return;
     }
 
@@ -142,7 +136,15 @@ static inline void rt_linked_fixalloc_remove(rt_linked_fixalloc_t *l, rt_linked_
 
     l->count--;
     fixalloc_free(&l->nodealloc, node);
+}
 
+static inline void rt_linked_fixalloc_remove(rt_linked_fixalloc_t *l, rt_linked_node_t *node) {
+    if (node == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&l->locker);
+    rt_linked_fixalloc_remove_no_lock(l, node);
     pthread_mutex_unlock(&l->locker);
 }
 
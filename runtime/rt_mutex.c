@@ -43,7 +43,7 @@ void rt_mutex_lock(rt_mutex_t *m) {
                 awoke = true;
             }
 
-            rt_do_spin();
+            rt_do_spin(iter);
             iter++;
 
             old = atomic_load(&m->state);
@@ -91,7 +91,7 @@ void rt_mutex_lock(rt_mutex_t *m) {
                 wait_start_time = uv_hrtime();
             }
 
-            rt_mutex_waiter_acquire(m, to_head);
+            rt_sema_acquire(&m->sema, to_head);
 
             // 更新 starving
             starving = starving || ((uv_hrtime() - wait_start_time) > MUTEX_STARVING_THRESHOLD_NS);
@@ -173,7 +173,7 @@ void rt_mutex_unlock(rt_mutex_t *m) {
 
             if (atomic_compare_exchange_strong(&m->state, &old, new)) {
                 // 预留等待着成功，正式解锁一个等待者
-                rt_mutex_waiter_release(m, false);
+                rt_sema_release(&m->sema, false);
                 return;
             }
 
@@ -186,7 +186,7 @@ void rt_mutex_unlock(rt_mutex_t *m) {
         // 但是如果 mutexStarving 被设置，互斥锁仍然被认为是锁定的，
         // 所以新来的 goroutine 不会获取它。
 
-        rt_mutex_waiter_release(m, true);
+        rt_sema_release(&m->sema, true);
     }
 }
 
@@ -196,16 +196,17 @@ bool rt_can_spin(int64_t iter) {
     }
 
     n_processor_t *p = processor_get();
-    if (!rt_linked_fixalloc_empty(&p->runnable_list)) {
+    if (runq_count(p) > 0) {
         return false;
     }
 
     return true;
 }
 
-void rt_do_spin() {
-    for (int i = 0; i < ACTIVE_SPIN_COUNT; i++) {
-        sched_yield();
+void rt_do_spin(int64_t iter) {
+    int64_t count = ACTIVE_SPIN_COUNT << iter;
+    for (int64_t i = 0; i < count; i++) {
+        cpu_relax();
     }
 }
 
@@ -215,11 +216,11 @@ static bool mutex_yield_commit(coroutine_t *co, void *chan_lock) {
 }
 
 
-void rt_mutex_waiter_acquire(rt_mutex_t *m, bool to_head) {
-    DEBUGF("[rt_mutex_waiter_acquire] m=%p, state=%lu, waiter_count=%lu, to_heap=%d", m, m->state, m->waiter_count,
+void rt_sema_acquire(rt_sema_t *s, bool to_head) {
+    DEBUGF("[rt_sema_acquire] s=%p, sema=%lu, waiter_count=%lu, to_heap=%d", s, s->sema, s->waiter_count,
            to_head);
     // 直接截获了 release 释放的信号量，不需要进入等待队列，直接返回
-    if (can_semacquire(&m->sema)) {
+    if (can_semacquire(&s->sema)) {
         return;
     }
 
@@ -228,98 +229,97 @@ void rt_mutex_waiter_acquire(rt_mutex_t *m, bool to_head) {
 
     // 未获取到信号，将当前 coroutine 加入到阻塞队列中, 并 yield 当前协程， 等待信号唤醒
     while (true) {
-        pthread_mutex_lock(&m->waiters.locker);
+        pthread_mutex_lock(&s->waiters.locker);
 
-        atomic_add_int64(&m->waiter_count, 1);
-        if (can_semacquire(&m->sema)) {
-            atomic_add_int64(&m->waiter_count, -1);
+        atomic_add_int64(&s->waiter_count, 1);
+        if (can_semacquire(&s->sema)) {
+            atomic_add_int64(&s->waiter_count, -1);
 
-            assertf(m->waiter_count == m->waiters.count, "waiter_count=%lu, waiters.count=%lu", m->waiter_count,
-                    m->waiters.count);
+            assertf(s->waiter_count == s->waiters.count, "waiter_count=%lu, waiters.count=%lu", s->waiter_count,
+                    s->waiters.count);
 
-            pthread_mutex_unlock(&m->waiters.locker);
+            pthread_mutex_unlock(&s->waiters.locker);
             break;
         }
 
         // no lock
         if (to_head) {
-            linkco_list_push_head(&m->waiters, co);
+            linkco_list_push_head(&s->waiters, co);
         } else {
-            linkco_list_push(&m->waiters, co);
+            linkco_list_push(&s->waiters, co);
         }
 
-        //        assertf(m->waiter_count == m->waiters.count, "waiter_count=%lu, waiters.count=%lu", m->waiter_count,
-        //                m->waiters.count);
+        //        assertf(s->waiter_count == s->waiters.count, "waiter_count=%lu, waiters.count=%lu", s->waiter_count,
+        //                s->waiters.count);
 
         // bug: 此时一旦解锁， release 就能读取 waiters 并 push 到 runnable list 中导致数据异常
         // 所以需要将锁延迟到 yield 到 sched 后再进行处理
-        co_yield_waiting(co, mutex_yield_commit, &m->waiters.locker);
+        co->wait_reason = TRACE_REASON_MUTEX;
+        uint64_t block_start = blockprof_start();
+        co_yield_waiting(co, mutex_yield_commit, &s->waiters.locker);
+        blockprof_end(block_start, TRACE_REASON_MUTEX);
 
         // co 返回，尝试获取信号量
-        if (co->ticket || can_semacquire(&m->sema)) {
+        if (co->ticket || can_semacquire(&s->sema)) {
             break;
         }
     }
 }
 
-void rt_mutex_waiter_release(rt_mutex_t *m, bool handoff) {
+void rt_sema_release(rt_sema_t *s, bool handoff) {
     // 无锁添加一个可以释放的信号
-    atomic_add_int64(&m->sema, 1);
+    atomic_add_int64(&s->sema, 1);
 
-    if (atomic_load(&m->waiter_count) == 0) {
-        assert(m->waiters.count == 0);
+    if (atomic_load(&s->waiter_count) == 0) {
+        assert(s->waiters.count == 0);
         // 无锁状态下 sema 被抢占消费
         return;
     }
 
     // > 0 开始加锁进行准确判断
-    pthread_mutex_lock(&m->waiters.locker);
+    pthread_mutex_lock(&s->waiters.locker);
 
     // 加锁期间，waiter_count 可能被其他线程消费
-    if (atomic_load(&m->waiter_count) == 0) {
-        assert(m->waiters.count == 0);
+    if (atomic_load(&s->waiter_count) == 0) {
+        assert(s->waiters.count == 0);
         // consumed by another
 
-        pthread_mutex_unlock(&m->waiters.locker);
+        pthread_mutex_unlock(&s->waiters.locker);
         return;
     }
 
     // waiter_count 存在无锁抢占，所以此处不能安全进行 assert
-    //    assertf(m->waiter_count == m->waiters.count, "waiter_count=%lu, waiters.count=%lu", m->waiter_count,
-    //            m->waiters.count);
+    //    assertf(s->waiter_count == s->waiters.count, "waiter_count=%lu, waiters.count=%lu", s->waiter_count,
+    //            s->waiters.count);
 
     //    if (atomic_flag_test_and_set(&lock_taken)) {
     //        assertf(false, "race: Lock already taken!");
     //    }
 
-    //    TDEBUGF("waiter info ...%d, %d, %p, %p", m->waiter_count, m->waiters.count, m->waiters.head, m->waiters.rear);
+    //    TDEBUGF("waiter info ...%d, %d, %p, %p", s->waiter_count, s->waiters.count, s->waiters.head, s->waiters.rear);
     // head pop
-    coroutine_t *wait_co = linkco_list_pop(&m->waiters);
+    coroutine_t *wait_co = linkco_list_pop(&s->waiters);
     assert(wait_co);
 
-    atomic_add_int64(&m->waiter_count, -1);
+    atomic_add_int64(&s->waiter_count, -1);
 
 
-    //    assertf(m->waiter_count == m->waiters.count, "waiter_count=%lu, waiters.count=%lu", m->waiter_count,
-    //            m->waiters.count);
+    //    assertf(s->waiter_count == s->waiters.count, "waiter_count=%lu, waiters.count=%lu", s->waiter_count,
+    //            s->waiters.count);
 
-    pthread_mutex_unlock(&m->waiters.locker);
+    pthread_mutex_unlock(&s->waiters.locker);
 
     n_processor_t *p = wait_co->p;
 
     // 尝试抢占自己释放的信号, 并将抢占标记传递给 wait_co
-    bool ticket = can_semacquire(&m->sema);
+    bool ticket = can_semacquire(&s->sema);
     if (ticket) {
         wait_co->ticket = true; // 抢占信号成功标识
     }
 
     // 先更新状态避免更新异常
     co_set_status(p, wait_co, CO_STATUS_RUNNABLE);
-    if (handoff) {
-        rt_linked_fixalloc_push_heap(&p->runnable_list, wait_co);
-    } else {
-        rt_linked_fixalloc_push(&p->runnable_list, wait_co);
-    }
+    runq_put_next(p, wait_co);
     // 如果 wait_co->p 和当前 co 在同一个 processor 中调度，则直接让出自己的控制权
     coroutine_t *co = coroutine_get();
     if (handoff && co->p == p) {
@@ -15,32 +15,48 @@
 #define MUTEX_STARVING_THRESHOLD_NS 1000 // 10ms
 
 #define ACTIVE_SPIN 4
-#define ACTIVE_SPIN_COUNT 30
+#define ACTIVE_SPIN_COUNT 30 // 首轮自旋中 cpu_relax 的次数, 后续每轮加倍
 
+// 信号量与等待队列，mutex/rwmutex/waitgroup 中阻塞的 coroutine 都通过 sema 进行等待和唤醒
 typedef struct {
-    ATOMIC int64_t state;
     ATOMIC int64_t sema;
     ATOMIC int64_t waiter_count;
     rt_linkco_list_t waiters; // 不需要预先初始化，值为 0 即可
+} rt_sema_t;
+
+// 内存布局需要与 std/co/mutex.n 中的 mutex_t 保持一致
+typedef struct {
+    ATOMIC int64_t state;
+    rt_sema_t sema;
 } rt_mutex_t;
 
 void rt_mutex_lock(rt_mutex_t *m);
 
+bool rt_mutex_try_lock(rt_mutex_t *m);
+
 void rt_mutex_unlock(rt_mutex_t *m);
 
 bool rt_can_spin(int64_t count);
 
-void rt_mutex_waiter_acquire(rt_mutex_t *m, bool to_head);
+/**
+ * 消费一个信号，没有可用信号时将当前 coroutine 加入到等待队列中并 yield
+ * @param s
+ * @param to_head
+ */
+void rt_sema_acquire(rt_sema_t *s, bool to_head);
 
 /**
  * 当 handoff = true 时，release 的 coroutine 将会被放在 runnable list 的最前面
  * 并直接 yield 当前 coroutine, 让 release coroutine 能够快速获取锁并工作
- * @param m
+ * @param s
  * @param handoff
  */
-void rt_mutex_waiter_release(rt_mutex_t *m, bool handoff);
+void rt_sema_release(rt_sema_t *s, bool handoff);
 
-void rt_do_spin();
+/**
+ * 第 iter 轮自旋, 执行 ACTIVE_SPIN_COUNT << iter 次 cpu_relax, 不会让出线程
+ */
+void rt_do_spin(int64_t iter);
 
 int64_t atomic_add_int64(ATOMIC int64_t *state, int64_t delta);
 
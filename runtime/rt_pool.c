@@ -0,0 +1,166 @@
+#include "rt_pool.h"
+#include "memory.h"
+
+rt_pool_t *pool_list;
+mutex_t pool_list_locker;
+
+static inline void pool_stack_push(rt_pool_stack_t *stack, void *obj) {
+    if (stack->count == stack->cap) {
+        stack->cap = stack->cap ? stack->cap * 2 : POOL_LOCAL_MAX;
+        stack->items = realloc(stack->items, sizeof(void *) * stack->cap);
+        assert(stack->items);
+    }
+
+    stack->items[stack->count++] = obj;
+}
+
+/**
+ * run_blocking 工作 processor 大部分时间阻塞在 c 调用中或者空闲, 缓存在其 local 中的对象在下一轮 gc 之前
+ * 无法被普通 processor 借取, 且工作 processor 访问 pool 的频率很低, 所以不使用 local 缓存, 直接访问 shared
+ */
+static inline rt_pool_local_t *pool_local(rt_pool_t *pool, n_processor_t *p) {
+    if (!p || p->blocking || p->index >= cpu_count) {
+        return NULL;
+    }
+
+    rt_pool_local_t *local = pool->locals[p->index];
+    if (!local) {
+        local = mallocz(sizeof(rt_pool_local_t));
+        pool->locals[p->index] = local;
+    }
+
+    return local;
+}
+
+rt_pool_t *rt_pool_new() {
+    rt_pool_t *pool = mallocz(sizeof(rt_pool_t));
+    mutex_init(&pool->locker, false);
+    pool->locals = mallocz(sizeof(rt_pool_local_t *) * cpu_count);
+
+    mutex_lock(&pool_list_locker);
+    pool->next = pool_list;
+    pool_list = pool;
+    mutex_unlock(&pool_list_locker);
+
+    DEBUGF("[rt_pool_new] pool=%p", pool);
+    return pool;
+}
+
+void *rt_pool_get(rt_pool_t *pool) {
+    assert(pool);
+    rt_pool_local_t *local = pool_local(pool, processor_get());
+    if (local && local->count > 0) {
+        return local->items[--local->count];
+    }
+
+    void *obj = NULL;
+    mutex_lock(&pool->locker);
+    if (pool->shared.count > 0) {
+        obj = pool->shared.items[--pool->shared.count];
+
+        // 批量借取到 local 中, 减少后续的加锁次数
+        while (local && local->count < POOL_LOCAL_MAX / 2 && pool->shared.count > 0) {
+            local->items[local->count++] = pool->shared.items[--pool->shared.count];
+        }
+    } else if (pool->victim.count > 0) {
+        obj = pool->victim.items[--pool->victim.count];
+    }
+    mutex_unlock(&pool->locker);
+
+    DEBUGF("[rt_pool_get] pool=%p, obj=%p", pool, obj);
+    return obj;
+}
+
+void rt_pool_put(rt_pool_t *pool, void *obj) {
+    assert(pool);
+    if (!obj) {
+        return;
+    }
+
+    // 池中的对象仅在 gc 开始时被扫描, mark 期间放入的对象需要主动着色
+    rt_shade_obj_with_barrier(obj);
+
+    rt_pool_local_t *local = pool_local(pool, processor_get());
+    if (local && local->count < POOL_LOCAL_MAX) {
+        local->items[local->count++] = obj;
+        return;
+    }
+
+    mutex_lock(&pool->locker);
+
+    // local 已满, 将一半转移到 shared 中供其他 processor 借取
+    while (local && local->count > POOL_LOCAL_MAX / 2) {
+        pool_stack_push(&pool->shared, local->items[--local->count]);
+    }
+
+    if (local) {
+        local->items[local->count++] = obj;
+    } else {
+        pool_stack_push(&pool->shared, obj);
+    }
+
+    mutex_unlock(&pool->locker);
+}
+
+void rt_pool_free(rt_pool_t *pool) {
+    assert(pool);
+
+    // 持有 pool_list_locker 时 pool_gc_scan 无法同时遍历到该 pool
+    mutex_lock(&pool_list_locker);
+    rt_pool_t **link = &pool_list;
+    while (*link && *link != pool) {
+        link = &(*link)->next;
+    }
+    assert(*link == pool);
+    *link = pool->next;
+    mutex_unlock(&pool_list_locker);
+
+    for (int i = 0; i < cpu_count; ++i) {
+        if (pool->locals[i]) {
+            free(pool->locals[i]);
+        }
+    }
+    free(pool->locals);
+    free(pool->shared.items);
+    free(pool->victim.items);
+    pthread_mutex_destroy(&pool->locker.locker);
+
+    DEBUGF("[rt_pool_free] pool=%p", pool);
+    free(pool);
+}
+
+void pool_gc_scan(rt_linked_fixalloc_t *worklist) {
+    mutex_lock(&pool_list_locker);
+    for (rt_pool_t *pool = pool_list; pool; pool = pool->next) {
+        mutex_lock(&pool->locker);
+
+        // 丢弃上一轮的 victim, 其中的对象本轮不再被 mark, 没有其他引用时会在本轮被清理
+        rt_pool_stack_t dropped = pool->victim;
+        pool->victim = pool->shared;
+        pool->shared = dropped;
+        pool->shared.count = 0;
+
+        for (int i = 0; i < cpu_count; ++i) {
+            rt_pool_local_t *local = pool->locals[i];
+            if (!local) {
+                continue;
+            }
+
+            for (int j = 0; j < local->count; ++j) {
+                pool_stack_push(&pool->victim, local->items[j]);
+            }
+            local->count = 0;
+        }
+
+        DEBUGF("[pool_gc_scan] pool=%p, victim count %ld", pool, pool->victim.count);
+        for (int64_t i = 0; i < pool->victim.count; ++i) {
+            void *obj = pool->victim.items[i];
+            if (span_of((addr_t) obj)) {
+                rt_linked_fixalloc_push(worklist, obj);
+            }
+        }
+
+        mutex_unlock(&pool->locker);
+    }
+    mutex_unlock(&pool_list_locker);
+}
@@ -0,0 +1,53 @@
+#ifndef NATURE_RT_POOL_H
+#define NATURE_RT_POOL_H
+
+#include "runtime.h"
+#include "processor.h"
+
+#define POOL_LOCAL_MAX 64 // 单个 processor 本地缓存的对象数量上限
+
+typedef struct {
+    int64_t count;
+    void *items[POOL_LOCAL_MAX];
+} rt_pool_local_t;
+
+typedef struct {
+    void **items;
+    int64_t count;
+    int64_t cap;
+} rt_pool_stack_t;
+
+/**
+ * 对象池, 由 std/co/sync.n 中的 pool_t 持有, 在 rt_pool_free 之前一直注册在 pool_list 中
+ * - locals 按照 processor index 索引, 仅 owner processor 访问, 不需要加锁
+ * - local 满时将一半对象转移到 shared 中, local 为空时从 shared 中批量借取, 最后再尝试 victim
+ * - 每轮 gc 开始时(stw) 丢弃 victim, 并将 locals 与 shared 中的对象整体转入 victim, 所以空闲对象最多存活两轮 gc
+ */
+typedef struct rt_pool_t {
+    mutex_t locker; // 保护 shared 与 victim
+    rt_pool_stack_t shared;
+    rt_pool_stack_t victim;
+    rt_pool_local_t **locals; // 长度为 cpu_count, blocking 工作 processor 不使用 local
+    struct rt_pool_t *next;
+} rt_pool_t;
+
+extern rt_pool_t *pool_list; // 所有已经创建的 pool, gc 时遍历
+extern mutex_t pool_list_locker;
+
+rt_pool_t *rt_pool_new();
+
+void *rt_pool_get(rt_pool_t *pool);
+
+void rt_pool_put(rt_pool_t *pool, void *obj);
+
+/**
+ * 从 pool_list 中移除并释放 pool, 池中的对象交由 gc 回收, 调用方需要保证之后不再访问 pool
+ */
+void rt_pool_free(rt_pool_t *pool);
+
+/**
+ * gc 开始时在 stw 中调用, 轮换 victim 并将池中的对象添加到 worklist 中避免被清理
+ */
+void pool_gc_scan(rt_linked_fixalloc_t *worklist);
+
+#endif //NATURE_RT_POOL_H
@@ -0,0 +1,194 @@
+#include "rt_sync.h"
+#include "runtime/processor.h"
+#include "runtime/runtime.h"
+#include <assert.h>
+#include <stdatomic.h>
+
+void rt_rwmutex_rlock(rt_rwmutex_t *rw) {
+    // writer 持有或者正在等待写锁时 reader_count 为负数，此时需要等待 writer 释放
+    if (atomic_add_int64(&rw->reader_count, 1) < 0) {
+        rt_sema_acquire(&rw->reader_sem, false);
+    }
+}
+
+bool rt_rwmutex_try_rlock(rt_rwmutex_t *rw) {
+    while (true) {
+        int64_t c = atomic_load(&rw->reader_count);
+        if (c < 0) {
+            return false;
+        }
+
+        if (atomic_compare_exchange_strong(&rw->reader_count, &c, c + 1)) {
+            return true;
+        }
+    }
+}
+
+void rt_rwmutex_runlock(rt_rwmutex_t *rw) {
+    int64_t r = atomic_add_int64(&rw->reader_count, -1);
+    if (r >= 0) {
+        return;
+    }
+
+    if (r + 1 == 0 || r + 1 == -RWMUTEX_MAX_READERS) {
+        assert(false && "runlock of unlocked rwmutex");
+    }
+
+    // writer 正在等待，最后一个离开的 reader 负责唤醒 writer
+    if (atomic_add_int64(&rw->reader_wait, -1) == 0) {
+        rt_sema_release(&rw->writer_sem, false);
+    }
+}
+
+void rt_rwmutex_lock(rt_rwmutex_t *rw) {
+    rt_mutex_lock(&rw->w);
+
+    // 通知 reader 存在等待中的 writer, 之后到达的 reader 将会阻塞，从而保证 writer 优先
+    int64_t r = atomic_add_int64(&rw->reader_count, -RWMUTEX_MAX_READERS) + RWMUTEX_MAX_READERS;
+
+    // 等待已经持有读锁的 reader 离开
+    if (r != 0 && atomic_add_int64(&rw->reader_wait, r) != 0) {
+        rt_sema_acquire(&rw->writer_sem, false);
+    }
+}
+
+bool rt_rwmutex_try_lock(rt_rwmutex_t *rw) {
+    if (!rt_mutex_try_lock(&rw->w)) {
+        return false;
+    }
+
+    int64_t expected = 0;
+    if (!atomic_compare_exchange_strong(&rw->reader_count, &expected, -RWMUTEX_MAX_READERS)) {
+        rt_mutex_unlock(&rw->w);
+        return false;
+    }
+
+    return true;
+}
+
+void rt_rwmutex_unlock(rt_rwmutex_t *rw) {
+    int64_t r = atomic_add_int64(&rw->reader_count, RWMUTEX_MAX_READERS);
+    if (r >= RWMUTEX_MAX_READERS) {
+        assert(false && "unlock of unlocked rwmutex");
+    }
+
+    // 唤醒 writer 持有锁期间阻塞的 reader
+    for (int64_t i = 0; i < r; ++i) {
+        rt_sema_release(&rw->reader_sem, false);
+    }
+
+    rt_mutex_unlock(&rw->w);
+}
+
+static bool semaphore_yield_commit(coroutine_t *co, void *locker) {
+    pthread_mutex_unlock(locker);
+    return true;
+}
+
+/**
+ * 按照 FIFO 顺序唤醒 waiters, 队首的权重无法满足时停止，避免大权重的 waiter 饥饿
+ * 需要持有 waiters.locker
+ */
+static void semaphore_notify_waiters(rt_semaphore_t *s) {
+    while (s->waiters.head) {
+        int64_t n = (int64_t) s->waiters.head->data;
+        if (s->size - s->cur < n) {
+            break;
+        }
+
+        s->cur += n;
+        coroutine_t *co = linkco_list_pop(&s->waiters);
+        assert(co);
+
+        // co 在 semaphore_yield_commit 中释放 locker 后才会进入 waiting 状态，所以持有 locker 时可以安全的唤醒
+        co_ready_next(co);
+    }
+}
+
+void rt_semaphore_acquire(rt_semaphore_t *s, int64_t n) {
+    if (n <= 0 || n > s->size) {
+        rti_throw(tlsprintf("semaphore acquire weight %ld out of range (0, %ld]", n, s->size), false);
+        return;
+    }
+
+    pthread_mutex_lock(&s->waiters.locker);
+    if (s->size - s->cur >= n && s->waiters.count == 0) {
+        s->cur += n;
+        pthread_mutex_unlock(&s->waiters.locker);
+        return;
+    }
+
+    coroutine_t *co = coroutine_get();
+    linkco_list_push(&s->waiters, co);
+    s->waiters.rear->data = (void *) n;
+
+    DEBUGF("[rt_semaphore_acquire] s=%p, size=%ld, cur=%ld, n=%ld, will yield to waiting", s, s->size, s->cur, n);
+
+    // 唤醒时 release 已经将 n 计入 cur 中
+    co->wait_reason = TRACE_REASON_MUTEX;
+    uint64_t block_start = blockprof_start();
+    co_yield_waiting(co, semaphore_yield_commit, &s->waiters.locker);
+    blockprof_end(block_start, TRACE_REASON_MUTEX);
+}
+
+bool rt_semaphore_try_acquire(rt_semaphore_t *s, int64_t n) {
+    if (n <= 0) {
+        return false;
+    }
+
+    pthread_mutex_lock(&s->waiters.locker);
+    bool success = s->size - s->cur >= n && s->waiters.count == 0;
+    if (success) {
+        s->cur += n;
+    }
+    pthread_mutex_unlock(&s->waiters.locker);
+
+    return success;
+}
+
+void rt_semaphore_release(rt_semaphore_t *s, int64_t n) {
+    pthread_mutex_lock(&s->waiters.locker);
+    if (n <= 0 || n > s->cur) {
+        pthread_mutex_unlock(&s->waiters.locker);
+        rti_throw(tlsprintf("semaphore released more than held (%ld > %ld)", n, s->cur), false);
+        return;
+    }
+
+    s->cur -= n;
+    semaphore_notify_waiters(s);
+    pthread_mutex_unlock(&s->waiters.locker);
+}
+
+void rt_waitgroup_add(rt_waitgroup_t *wg, int64_t delta) {
+    int64_t state = atomic_add_int64(&wg->state, delta << WAITGROUP_COUNTER_SHIFT);
+    int64_t v = state >> WAITGROUP_COUNTER_SHIFT;
+    int64_t w = state & WAITGROUP_WAITER_MASK;
+    if (v < 0) {
+        rti_throw("negative waitgroup counter", false);
+        return;
+    }
+
+    if (v > 0 || w == 0) {
+        return;
+    }
+
+    // counter 归零，此时不会再有新的 waiter 加入，重置 state 并唤醒所有 waiter
+    atomic_store(&wg->state, 0);
+    for (int64_t i = 0; i < w; ++i) {
+        rt_sema_release(&wg->sema, false);
+    }
+}
+
+void rt_waitgroup_wait(rt_waitgroup_t *wg) {
+    while (true) {
+        int64_t state = atomic_load(&wg->state);
+        if ((state >> WAITGROUP_COUNTER_SHIFT) == 0) {
+            return;
+        }
+
+        if (atomic_compare_exchange_strong(&wg->state, &state, state + 1)) {
+            rt_sema_acquire(&wg->sema, false);
+            return;
+        }
+    }
+}
@@ -0,0 +1,65 @@
+#ifndef NATURE_RT_SYNC_H
+#define NATURE_RT_SYNC_H
+
+#include "rt_mutex.h"
+
+#define RWMUTEX_MAX_READERS (1 << 30)
+
+#define WAITGROUP_COUNTER_SHIFT 32
+#define WAITGROUP_WAITER_MASK 0xffffffff
+
+/**
+ * 写优先的读写锁, 内存布局需要与 std/co/mutex.n 中的 rwmutex_t 保持一致
+ * writer 加锁时将 reader_count 减去 RWMUTEX_MAX_READERS, 之后到达的 reader 看到负数后在 reader_sem 中等待,
+ * 已经持有读锁的 reader 数量记录在 reader_wait 中，最后一个离开的 reader 通过 writer_sem 唤醒 writer
+ */
+typedef struct {
+    rt_mutex_t w; // writer 之间互斥
+    rt_sema_t writer_sem;
+    rt_sema_t reader_sem;
+    ATOMIC int64_t reader_count;
+    ATOMIC int64_t reader_wait;
+} rt_rwmutex_t;
+
+/**
+ * 带权重的计数信号量, waiters 中按照 FIFO 顺序唤醒, linkco->data 中记录等待的权重
+ * 内存布局需要与 std/co/sync.n 中的 semaphore_t 保持一致
+ */
+typedef struct {
+    int64_t size;
+    int64_t cur;
+    rt_linkco_list_t waiters;
+} rt_semaphore_t;
+
+/**
+ * state 高 32 位为计数器，低 32 位为 wait 中的 coroutine 数量
+ * 内存布局需要与 std/co/sync.n 中的 waitgroup_t 保持一致
+ */
+typedef struct {
+    ATOMIC int64_t state;
+    rt_sema_t sema;
+} rt_waitgroup_t;
+
+void rt_rwmutex_rlock(rt_rwmutex_t *rw);
+
+bool rt_rwmutex_try_rlock(rt_rwmutex_t *rw);
+
+void rt_rwmutex_runlock(rt_rwmutex_t *rw);
+
+void rt_rwmutex_lock(rt_rwmutex_t *rw);
+
+bool rt_rwmutex_try_lock(rt_rwmutex_t *rw);
+
+void rt_rwmutex_unlock(rt_rwmutex_t *rw);
+
+void rt_semaphore_acquire(rt_semaphore_t *s, int64_t n);
+
+bool rt_semaphore_try_acquire(rt_semaphore_t *s, int64_t n);
+
+void rt_semaphore_release(rt_semaphore_t *s, int64_t n);
+
+void rt_waitgroup_add(rt_waitgroup_t *wg, int64_t delta);
+
+void rt_waitgroup_wait(rt_waitgroup_t *wg);
+
+#endif //NATURE_RT_SYNC_H
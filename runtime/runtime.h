@@ -23,6 +23,8 @@
 #define ATOMIC _Atomic
 #endif
 
+#include "futex.h" // 依赖 ATOMIC
+
 /**
  * crt1.o _start -> main  -> entry
  */
@@ -36,11 +38,22 @@ int runtime_main(int argc, char *argv[]) __asm("main");
 
 
 #ifdef __AMD64
-#define CALLER_RET_ADDR(_co)                                  \
-    ({                                                        \
-        uint64_t _rbp_value;                                  \
-        __asm__ volatile("mov %%rbp, %0" : "=r"(_rbp_value)); \
-        fetch_addr_value(_rbp_value + POINTER_SIZE);          \
+#ifdef __DARWIN
+extern void assist_preempt_return() __asm__("_assist_preempt_return");
+#else
+extern void assist_preempt_return() __asm__("assist_preempt_return");
+#endif
+
+// 返回地址可能被异步抢占替换为 assist_preempt_return
+#define CALLER_RET_ADDR(_co)                                             \
+    ({                                                                   \
+        uint64_t _rbp_value;                                             \
+        __asm__ volatile("mov %%rbp, %0" : "=r"(_rbp_value));            \
+        uint64_t _value = fetch_addr_value(_rbp_value + POINTER_SIZE);   \
+        if (_value == (uint64_t) assist_preempt_return) {                \
+            _value = (_co)->preempt_ret_addr;                            \
+        }                                                                \
+        _value;                                                          \
     });
 #elif defined(__ARM64)
 #define CALLER_RET_ADDR(_co)                                          \
@@ -63,8 +76,26 @@ int runtime_main(int argc, char *argv[]) __asm("main");
 #endif
 
 #define P_LINKCO_CACHE_MAX 128
+#define P_CO_CACHE_MAX 256 // processor 本地缓存的已释放 coroutine 数量上限
+#define P_CO_CACHE_BATCH 32 // 本地缓存为空或者已满时与全局 coroutine_alloc 批量交换的数量
+#define CO_SAVE_STACK_CACHE_MAX 16384 // 不超过该大小的 save_stack 会按照 size class 缓存复用
+#define SAVE_STACK_MIN_SHIFT 6 // 最小的 save_stack size class 为 64byte
+#define SAVE_STACK_CLASS_COUNT 9 // 64byte ~ CO_SAVE_STACK_CACHE_MAX
+#define P_SAVE_STACK_CACHE_MAX 32 // 每个 size class 本地缓存的 save_stack 数量上限
+#define P_RUNQ_SIZE 256 // 必须是 2 的幂
+#define P_RUNQ_OVERFLOW_TICK 61 // 每调度 61 次优先检查一次 runq_overflow
+#define P_SPIN_ROUNDS 4 // 空闲 processor park 之前自旋窃取的轮次
+#define P_HANDLE_BATCH 100 // 单轮调度最多 resume 的 coroutine 数量, 之后需要回到 uv_loop 处理 io/timer 事件
+
+#define SCHED_TIME_SLICE 10 // coroutine 默认时间片, 单位 ms
+#define BLOCKING_WORKER_MAX 64 // run_blocking 工作线程数量上限的默认值
+#define SCHED_HIST_BUCKETS 32 // 调度延迟直方图桶数量, 桶 i 记录 [2^(i-1), 2^i) us
+#define TIMER_WHEEL_BITS 6
+#define TIMER_WHEEL_SLOTS (1 << TIMER_WHEEL_BITS) // 每一层的槽位数量
+#define TIMER_WHEEL_LEVELS 4 // 精度为 1ms, 4 层可以覆盖约 4.6 小时, 更长的超时会在最高层中多次级联
 
 #define GC_WORKLIST_LIMIT 1024 // 每处理 1024 个 ptr 就 yield
+#define GC_MARK_WORKER_FRACTION 4 // 每 4 个 processor 启动 1 个独立的 mark worker 线程
 
 #define ARENA_SIZE 67108864 // arena 的大小，单位 byte, 64M
 
@@ -296,7 +327,7 @@ typedef struct {
 
 typedef struct {
     mheap_t *mheap; // 全局 heap, 访问时需要加锁
-    mutex_t locker;
+    futex_locker_t locker;
     uint32_t sweepgen;
     uint64_t gc_count; // gc 循环次数
 } memory_t;
@@ -314,7 +345,7 @@ typedef enum {
     P_STATUS_INIT = 0,
     P_STATUS_DISPATCH = 1,
 
-    //    P_STATUS_TPLCALL = 2,
+    P_STATUS_TPLCALL = 2, // 阻塞在 c 函数(libc/syscall)中, 不可抢占, gc 视为已经到达安全点
     //    P_STATUS_RTCALL = 3,
 
     P_STATUS_RUNNABLE = 3,
@@ -326,6 +357,39 @@ typedef enum {
 typedef struct n_processor_t n_processor_t;
 typedef struct coroutine_t coroutine_t;
 
+typedef enum {
+    SCHED_HIST_RUN = 0, // coroutine 单次 resume 运行的时长
+    SCHED_HIST_WAIT, // coroutine 进入 runq 到被 resume 的等待时长
+    SCHED_HIST_IO, // processor park 在 uv_loop 中等待 io/timer 的时长
+    SCHED_HIST_MAX,
+} sched_hist_kind_t;
+
+typedef struct {
+    uint64_t count;
+    uint64_t sum; // 单位 ns
+    uint64_t buckets[SCHED_HIST_BUCKETS];
+} sched_hist_t;
+
+typedef struct rt_timer_t rt_timer_t;
+
+typedef void (*rt_timer_fn)(rt_timer_t *timer);
+
+// 嵌入到 coroutine 等结构中使用, 不需要单独申请内存
+struct rt_timer_t {
+    uint64_t expire; // 到期时间, 单位 ms
+    rt_timer_t *next;
+    rt_timer_t **pprev; // 指向前一个节点的 next(或者槽位)，为 null 表示不在时间轮中
+    rt_timer_fn fn;
+    void *data;
+};
+
+// 分层时间轮, 仅 owner processor 线程访问
+typedef struct {
+    rt_timer_t *slots[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+    uint64_t tick; // 已经处理到的时间, 单位 ms
+    uint64_t count;
+} timer_wheel_t;
+
 // lock_of is n_chan_t or rt_mutex_t
 typedef bool (*unlock_fn)(coroutine_t *co, void *lock_of);
 
@@ -343,12 +407,32 @@ struct linkco_t {
     bool success; // chan recv/send 是否成功
 };
 
+/**
+ * co.await_all/await_any 的共享完成计数, 调用方只需要 park 一次
+ * pending 归零时由最后一个退出的 coroutine 唤醒 waiter, 注册期间调用方持有一个额外的计数避免提前唤醒
+ */
+typedef struct {
+    ATOMIC int64_t pending;
+    coroutine_t *waiter;
+    bool any; // await_any 中只有第一个退出的 coroutine 减少 pending
+    ATOMIC bool fired;
+} await_group_t;
+
+/**
+ * 同一个 coroutine 可以同时被多个 group 等待(重复的 future 或者多个 waiter await 重叠的 future),
+ * 每次注册对应一个节点, 在 future 对应的 future_locker 中读写
+ */
+typedef struct await_group_node_t {
+    await_group_t *group;
+    struct await_group_node_t *next;
+} await_group_node_t;
+
 // 必须和 nature code 保持一致
 typedef struct n_future_t {
     int64_t size;
     void *result;
     n_union_t *error; // 类似 result 一样可选的 error
-    void *await_co;
+    void *co; // coroutine 退出时置空, 退出后的 coroutine 会被 gc 回收复用，不能再通过该指针访问
 } n_future_t;
 
 struct coroutine_t {
@@ -369,7 +453,7 @@ struct coroutine_t {
     n_future_t *future;
 
     struct coroutine_t *await_co; // 可能为 null, 如果不为 null 说明该 co 在等待当前 co exit
-    mutex_t dead_locker;
+    await_group_node_t *await_groups; // 可能为 null, 当前 co exit 时需要减少每个 group 的 pending
 
     // 当前 coroutine stack 颜色是否为黑色, 黑色说明当前 goroutine stack 已经扫描完毕
     // gc stage 是 mark 时, 当 gc_black 值小于 memory->gc_count 时，说明当前 coroutine stack 不是黑色的
@@ -413,6 +497,18 @@ struct coroutine_t {
     //    uint64_t scan_offset;
     //    uint64_t scan_ret_addr;
 
+    // 异步抢占时 pc 位于 c 函数中，会将 c 函数返回到 nature fn 的返回地址替换为 assist_preempt_return, 原返回地址记录在这里
+    addr_t preempt_ret_addr;
+
+    rt_timer_t timer; // co.sleep 使用的定时器
+
+    bool own_stack; // 使用独立栈(costack)而不是 processor 的 share_stack
+    uint32_t switch_count; // resume 返回的次数
+    uint64_t stack_depth_max; // resume 返回时观察到的最大栈深度, 共享栈模式下既单次切换需要拷贝的栈大小
+
+    uint8_t wait_reason; // trace_reason_t, co_yield_waiting 时写入, 被唤醒(runq_put)时清空
+    uint64_t runnable_at; // 进入 runq 的时间(纳秒), 被 processor resume 时清零, 窃取迁移时保持不变
+
     bool has_error;
     n_interface_t *error; // throwable
     n_vec_t *traces; // element is n_trace_t
@@ -422,7 +518,7 @@ struct coroutine_t {
     unlock_fn wait_unlock_fn;
     void *wait_lock;
 
-    struct coroutine_t *next; // coroutine list
+    struct coroutine_t *next; // coroutine list, 用于 p->runq_inject
 };
 
 /**
@@ -438,6 +534,8 @@ struct n_processor_t {
 
     struct sigaction sig;
     uv_timer_t timer; // 辅助协程调度的定时器
+    timer_wheel_t timer_wheel; // coroutine sleep/超时定时器
+    uv_timer_t timer_wheel_uv; // 按照 timer_wheel 最近的到期时间设置, 用于唤醒 park 中的 processor
     uv_loop_t uv_loop; // uv loop 事件循环
 
     uint64_t need_stw; // 外部声明, 内部判断 是否需要 stw
@@ -456,8 +554,36 @@ struct n_processor_t {
     linkco_t *linkco_cache[P_LINKCO_CACHE_MAX];
     uint8_t linkco_count;
 
+    // 已释放的 coroutine(co->next 链接), 仅 owner 线程访问
+    coroutine_t *co_cache;
+    uint32_t co_cache_count;
+
+    // 按照 size class 缓存的空闲 save_stack, 通过首个字长链接, 仅 owner 线程访问, gc_work 中整体标记
+    void *save_stack_cache[SAVE_STACK_CLASS_COUNT];
+    uint8_t save_stack_cache_count[SAVE_STACK_CLASS_COUNT];
+
     rt_linked_fixalloc_t co_list; // 当前 processor 下的 coroutine 列表
-    rt_linked_fixalloc_t runnable_list;
+
+    // 本地无锁可运行队列, 仅 owner 线程写入 runq_tail, owner 与窃取者通过 cas runq_head 进行消费
+    ATOMIC uint32_t runq_head;
+    ATOMIC uint32_t runq_tail;
+    coroutine_t *runq[P_RUNQ_SIZE];
+    coroutine_t *ATOMIC runq_inject; // 其他线程通过 cas 推入的 coroutine 栈(co->next 链接), 由 owner 批量取出
+    coroutine_t *ATOMIC runnext; // 当前 coroutine 唤醒的 coroutine, 下一次调度时优先运行, 仅 owner 线程写入且不参与窃取
+    uint64_t runnext_started_at; // runnext 继承的时间片开始时间, 取出 runnext 运行时作为其 co_started_at
+    rt_linked_fixalloc_t runq_overflow; // runq 满时溢出的 coroutine, 需要加锁访问
+    uint32_t schedtick; // 调度计数, 用于定期检查 runq_overflow 避免饥饿
+    sched_hist_t sched_hist[SCHED_HIST_MAX]; // 仅 owner 线程写入, 读取时允许存在轻微的不一致
+    bool preempted; // 最近一次 resume 的 coroutine 是否被抢占, 抢占后需要优先处理 uv_loop 中的 io/timer 事件
+
+    uv_async_t wake_async; // 唤醒 park 在 uv_loop 中的 processor
+    ATOMIC bool parked; // 当前 processor 是否阻塞在 uv_loop 中等待唤醒
+
+    bool blocking; // run_blocking 工作 processor, 不参与 dispatch/窃取, 仅运行 CO_FLAG_BLOCKING coroutine
+    ATOMIC int64_t blocking_load; // 已经分配到当前工作 processor 但尚未退出的 blocking coroutine 数量
+
+    int cpu; // 绑定的 cpu, 未绑定时为 -1
+    int numa_node; // cpu 所在的 numa node, 未绑定或者无法读取时为 0
 
     rt_linked_fixalloc_t gc_worklist; // gc 扫描的 ptr 节点列表
     uint64_t gc_work_finished; // 当前处理的 GC 轮次，每完成一轮 + 1
@@ -496,9 +622,13 @@ void processor_set_status(n_processor_t *p, p_status_t status);
 //        CO_SCAN_REQUIRE(_co);                                                                           \
 //    } while (0);
 
-//void pre_tplcall_hook();
+/**
+ * 调用可能长时间阻塞的 c 函数(sleep/waitpid/read 等)前后调用, 期间 p 处于 P_STATUS_TPLCALL 状态
+ * post_tplcall_hook 在 stw 期间会等待 stw 结束后再返回
+ */
+void pre_tplcall_hook();
 
-//void post_tplcall_hook();
+void post_tplcall_hook();
 
 //void post_rtcall_hook(char *target);
 
@@ -4,7 +4,13 @@
 
 #include "sysmon.h"
 
-#define CO_TIMEOUT (10 * 1000 * 1000) // ms
+#include "blocking.h"
+
+// 时间片通过 sched_tunables.time_slice 配置, runq 为空时长时间运行的 coroutine 依旧会阻塞 uv_loop 中 io/timer 事件的处理
+#define CO_IO_TIMEOUT_FACTOR 5
+
+// gc eval 的间隔, 单位 us
+#define GC_EVAL_INTERVAL (100 * 1000)
 
 // 等待 1000ms 的时间，如果无法抢占则 deadlock
 #define PREEMPT_TIMEOUT 1000
@@ -79,7 +85,7 @@ static void solo_processor_sysmon() {
     //                continue;
     //            }
     //            uint64_t time = (uv_hrtime() - co_start_at);
-    //            if (time < CO_TIMEOUT) {
+    //            if (time < timeout) {
     //                RDEBUGF("[wait_sysmon.share] p_index=%d, co=%p run not timeout(%lu ms), will skip", p->index,
     //                        p->coroutine,
     //                        time / 1000 / 1000);
@@ -135,7 +141,7 @@ static void solo_processor_sysmon() {
     //                goto SOLO_UNLOCK_NEXT;
     //            }
     //            time = (uv_hrtime() - co_start_at);
-    //            if (time < CO_TIMEOUT) {
+    //            if (time < timeout) {
     //                DEBUGF("[wait_sysmon.solo.thread_locker] p_index=%d, not run timeout(%lu ms),  goto unlock", p->index,
     //                       time / 1000 / 1000);
     //                goto SOLO_UNLOCK_NEXT;
@@ -230,10 +236,10 @@ static void solo_processor_sysmon() {
 static void processor_sysmon() {
     // - 监控长时间被占用的 share processor 进行抢占式调度
     PROCESSOR_FOR(processor_list) {
-        // 没有需要运行的 runnable_list(等待运行的 runnable) 并且当前也不需要 stw 则不需要则不考虑抢占
-        if (p->need_stw == 0 && p->runnable_list.count == 0) {
-            DEBUGF("[processor_sysmon] p_index=%d p_status=%d runnable_list.count == 0 cannot preempt, will skip", p->index, p->status);
-            continue;
+        // 没有需要运行的 runq(等待运行的 runnable) 并且当前也不需要 stw 时，使用更长的超时时间(仅为了处理 uv_loop 中的事件)
+        uint64_t timeout = sched_tunables.time_slice;
+        if (p->need_stw == 0 && runq_count(p) == 0) {
+            timeout = sched_tunables.time_slice * CO_IO_TIMEOUT_FACTOR;
         }
 
         // 还未随 thread 初始化完成
@@ -242,9 +248,21 @@ static void processor_sysmon() {
             continue;
         }
 
-        // 已经设置过辅助 GC 不需要处理
-        if (*p->tls_yield_safepoint_ptr) {
-            DEBUGF("[processor_sysmon] p_index=%d p_status=%d tls_yield_safepoint_ptr is false cannot preempt, will skip", p->index, p->status);
+        // blocking 工作 processor 中的 coroutine 允许长时间运行，仅在 stw 或者有其他任务排队时进行抢占
+        if (p->blocking && p->need_stw == 0 && runq_count(p) == 0) {
+            continue;
+        }
+
+        // 阻塞在 c 函数中时不能抢占(信号会打断 sleep 等调用), 超时后将 runq 交给其他 processor 运行
+        if (p->status == P_STATUS_TPLCALL) {
+            if (p->blocking) {
+                continue;
+            }
+
+            uint64_t tplcall_at = p->co_started_at;
+            if (tplcall_at > 0 && uv_hrtime() - tplcall_at >= sched_tunables.time_slice && runq_count(p) > 0) {
+                processor_handoff(p);
+            }
             continue;
         }
 
@@ -269,13 +287,21 @@ static void processor_sysmon() {
             continue;
         }
         uint64_t time = (uv_hrtime() - co_start_at);
-        if (time < CO_TIMEOUT) {
+        if (time < timeout) {
             DEBUGF("[processor_sysmon] p_index=%d, co=%p/%p run not timeout(%lu ms), will skip", p->index,
                    p->coroutine, co,
                    time / 1000 / 1000);
             continue;
         }
 
+        // 已经设置过 safepoint 但 coroutine 依旧没有让出(没有 safepoint 的循环或者长时间的 c 调用), 发送信号进行异步抢占
+        if (*p->tls_yield_safepoint_ptr) {
+            DEBUGF("[processor_sysmon] p_index=%d(%lu), co=%p not reach safepoint, will send preempt signal", p->index,
+                   (uint64_t) p->thread_id, p->coroutine);
+            processor_preempt_signal(p);
+            continue;
+        }
+
         // 设置辅助 yield (如果 processor 进入 safepoint, 则会清空 safepoint)
         *p->tls_yield_safepoint_ptr = true;
 
@@ -285,23 +311,29 @@ static void processor_sysmon() {
 }
 
 static void wait_sysmon() {
-    // 每 50 * 10ms 进行 eval 一次
-    int gc_eval_count = WAIT_SHORT_TIME;
+    // 无论 sysmon_tick 如何配置, 都保持约 100ms 进行一次 gc eval
+    int64_t gc_eval_interval = GC_EVAL_INTERVAL / sched_tunables.sysmon_tick;
+    if (gc_eval_interval <= 0) {
+        gc_eval_interval = 1;
+    }
+    int64_t gc_eval_count = gc_eval_interval;
 
-    // 循环监控(每 10ms 监控一次)
+    // 循环监控(默认每 10ms 监控一次)
     while (true) {
         DEBUGF("[wait_sysmon] will processor sysmon ");
 
         processor_sysmon();
 
+        blocking_sysmon();
+
         DEBUGF("[wait_sysmon] sysmon end, will eval gc %ld", gc_eval_count);
         // - GC 判断 (每 100ms 进行一次)
         if (gc_eval_count <= 0) {
             runtime_eval_gc();
-            gc_eval_count = WAIT_SHORT_TIME; // 10 * 10ms = 100ms
+            gc_eval_count = gc_eval_interval;
         }
         gc_eval_count--;
-        usleep(WAIT_SHORT_TIME * 1000); // 10ms
+        usleep(sched_tunables.sysmon_tick);
     }
 }
 
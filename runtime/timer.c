@@ -0,0 +1,187 @@
+#include "timer.h"
+
+#include "processor.h"
+
+#define TIMER_WHEEL_MASK (TIMER_WHEEL_SLOTS - 1)
+
+static inline uint64_t timer_now_ms() {
+    return uv_hrtime() / 1000 / 1000;
+}
+
+static inline uint64_t timer_level_index(uint64_t ms, int level) {
+    return (ms >> (TIMER_WHEEL_BITS * level)) & TIMER_WHEEL_MASK;
+}
+
+/**
+ * 根据 expire 与 w->tick 的距离选择层级, 超出最高层范围时放在最高层, 级联时会根据 expire 重新放置
+ */
+static void timer_link(timer_wheel_t *w, rt_timer_t *timer) {
+    uint64_t expire = timer->expire < w->tick ? w->tick : timer->expire;
+    uint64_t delta = expire - w->tick;
+
+    int level = 0;
+    while (level < TIMER_WHEEL_LEVELS - 1 && delta >> (TIMER_WHEEL_BITS * (level + 1))) {
+        level++;
+    }
+
+    uint64_t max = (uint64_t) 1 << (TIMER_WHEEL_BITS * TIMER_WHEEL_LEVELS);
+    if (delta >= max) {
+        expire = w->tick + max - 1;
+    }
+
+    rt_timer_t **head = &w->slots[level][timer_level_index(expire, level)];
+    timer->next = *head;
+    if (timer->next) {
+        timer->next->pprev = &timer->next;
+    }
+    *head = timer;
+    timer->pprev = head;
+}
+
+static void timer_unlink(rt_timer_t *timer) {
+    *timer->pprev = timer->next;
+    if (timer->next) {
+        timer->next->pprev = timer->pprev;
+    }
+    timer->next = NULL;
+    timer->pprev = NULL;
+}
+
+/**
+ * 将 level 层当前槽位中的定时器重新放置到低层中
+ */
+static void timer_cascade(timer_wheel_t *w, int level) {
+    rt_timer_t **head = &w->slots[level][timer_level_index(w->tick, level)];
+    rt_timer_t *timer = *head;
+    *head = NULL;
+
+    while (timer) {
+        rt_timer_t *next = timer->next;
+        timer->next = NULL;
+        timer->pprev = NULL;
+        timer_link(w, timer);
+        timer = next;
+    }
+}
+
+void timer_wheel_init(n_processor_t *p) {
+    memset(&p->timer_wheel, 0, sizeof(timer_wheel_t));
+    p->timer_wheel.tick = timer_now_ms();
+    uv_timer_init(&p->uv_loop, &p->timer_wheel_uv);
+}
+
+void timer_add(n_processor_t *p, rt_timer_t *timer, uint64_t timeout_ms) {
+    assert(!timer_active(timer));
+    timer_wheel_t *w = &p->timer_wheel;
+    uint64_t now = timer_now_ms();
+
+    // 时间轮为空时直接跳到当前时间, 避免 timer_wheel_run 逐个 tick 追赶
+    if (w->count == 0) {
+        w->tick = now;
+    }
+
+    // w->tick 对应的槽位已经处理过，所以最早在下一个 tick 触发
+    timer->expire = now + timeout_ms;
+    if (timer->expire <= w->tick) {
+        timer->expire = w->tick + 1;
+    }
+
+    timer_link(w, timer);
+    w->count++;
+
+    TRACEF("[runtime.timer_add] p_index=%d, timer=%p, expire=%lu, tick=%lu, count=%lu", p->index, timer,
+           timer->expire, w->tick, w->count);
+}
+
+void timer_del(n_processor_t *p, rt_timer_t *timer) {
+    if (!timer_active(timer)) {
+        return;
+    }
+
+    timer_unlink(timer);
+    p->timer_wheel.count--;
+}
+
+int64_t timer_wheel_run(n_processor_t *p) {
+    timer_wheel_t *w = &p->timer_wheel;
+    if (w->count == 0) {
+        return 0;
+    }
+
+    uint64_t now = timer_now_ms();
+    int64_t fired = 0;
+    while (w->tick < now) {
+        w->tick++;
+
+        // 低层转完一圈，依次从高层级联
+        for (int level = 1; level < TIMER_WHEEL_LEVELS; ++level) {
+            if (timer_level_index(w->tick, level - 1) != 0) {
+                break;
+            }
+
+            timer_cascade(w, level);
+        }
+
+        rt_timer_t **head = &w->slots[0][timer_level_index(w->tick, 0)];
+        rt_timer_t *timer = *head;
+        *head = NULL;
+        while (timer) {
+            rt_timer_t *next = timer->next;
+            timer->next = NULL;
+            timer->pprev = NULL;
+            w->count--;
+            fired++;
+
+            timer->fn(timer);
+            timer = next;
+        }
+
+        if (w->count == 0) {
+            w->tick = now;
+            break;
+        }
+    }
+
+    return fired;
+}
+
+/**
+ * @return 下一次需要处理的时间(定时器到期或者高层级联), 单位 ms
+ */
+static uint64_t timer_wheel_next(timer_wheel_t *w) {
+    uint64_t next = UINT64_MAX;
+    for (int level = 0; level < TIMER_WHEEL_LEVELS; ++level) {
+        uint64_t base = w->tick >> (TIMER_WHEEL_BITS * level);
+        for (uint64_t i = 1; i <= TIMER_WHEEL_SLOTS; ++i) {
+            if (w->slots[level][(base + i) & TIMER_WHEEL_MASK]) {
+                uint64_t at = (base + i) << (TIMER_WHEEL_BITS * level);
+                if (at < next) {
+                    next = at;
+                }
+                break;
+            }
+        }
+    }
+
+    return next;
+}
+
+static void on_timer_wheel_cb(uv_timer_t *handle) {
+    // 仅用于让 uv_run 返回，到期的定时器由 processor_run 通过 timer_wheel_run 处理
+}
+
+void timer_wheel_arm(n_processor_t *p) {
+    timer_wheel_t *w = &p->timer_wheel;
+    if (w->count == 0) {
+        uv_timer_stop(&p->timer_wheel_uv);
+        return;
+    }
+
+    uint64_t now = timer_now_ms();
+    uint64_t next = timer_wheel_next(w);
+    uint64_t timeout = next > now ? next - now : 0;
+
+    // uv_timer 基于 loop 缓存的时间计算到期时间, 需要先更新
+    uv_update_time(&p->uv_loop);
+    uv_timer_start(&p->timer_wheel_uv, on_timer_wheel_cb, timeout, 0);
+}
@@ -0,0 +1,40 @@
+#ifndef NATURE_TIMER_H
+#define NATURE_TIMER_H
+
+#include "runtime.h"
+
+/**
+ * 每个 processor 持有一个分层时间轮(精度 1ms), 用于 coroutine sleep 与超时处理。
+ * 第 n 层的每个槽位覆盖 2^(TIMER_WHEEL_BITS * n) ms, 低层转完一圈时将高层对应槽位中的定时器级联到低层。
+ * 添加/删除都是 O(1), 所有定时器共用 processor 中的一个 uv_timer, 仅在 park 之前按照最近的到期时间设置。
+ */
+
+void timer_wheel_init(n_processor_t *p);
+
+/**
+ * 仅允许 p 的 owner 线程调用, timer->fn 同样在 owner 线程中回调
+ * @param timeout_ms 为 0 时在下一次 timer_wheel_run 中触发
+ */
+void timer_add(n_processor_t *p, rt_timer_t *timer, uint64_t timeout_ms);
+
+/**
+ * 仅允许 p 的 owner 线程调用, timer 不在时间轮中时不做处理
+ */
+void timer_del(n_processor_t *p, rt_timer_t *timer);
+
+static inline bool timer_active(rt_timer_t *timer) {
+    return timer->pprev != NULL;
+}
+
+/**
+ * 推进时间轮到当前时间并回调所有到期的定时器
+ * @return 触发的定时器数量
+ */
+int64_t timer_wheel_run(n_processor_t *p);
+
+/**
+ * park 之前调用，按照最近的到期时间设置 timer_wheel_uv, 时间轮为空时停止 timer_wheel_uv
+ */
+void timer_wheel_arm(n_processor_t *p);
+
+#endif // NATURE_TIMER_H
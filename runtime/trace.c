@@ -0,0 +1,278 @@
+#include "trace.h"
+
+#include <stdio.h>
+
+#include "processor.h"
+#include "runtime/nutils/nutils.h"
+
+ATOMIC bool trace_enabled = false;
+
+#define TRACE_BUF_MAX (PROCESSOR_MAX + TRACE_SYSTEM_THREAD_MAX)
+
+// [0, cpu_count) 对应 processor, 之后是 blocking 工作线程与 gc/sysmon 等其他线程, 在首次写入事件时注册, 下标即导出的 tid
+static trace_buf_t *ATOMIC trace_bufs[TRACE_BUF_MAX];
+static ATOMIC int trace_buf_count = 0;
+static _Thread_local trace_buf_t *tls_trace_buf = NULL;
+static _Thread_local bool tls_trace_full = false;
+static _Thread_local bool tls_trace_named = false; // 是否已经按照 processor index 命名
+static uint64_t trace_start_at = 0;
+static char *trace_env_path = NULL;
+
+static char *trace_reason_names[] = {
+        [TRACE_REASON_NONE] = "none",
+        [TRACE_REASON_IO] = "io",
+        [TRACE_REASON_CHAN] = "chan",
+        [TRACE_REASON_MUTEX] = "mutex",
+        [TRACE_REASON_SLEEP] = "sleep",
+        [TRACE_REASON_SELECT] = "select",
+        [TRACE_REASON_AWAIT] = "await",
+        [TRACE_REASON_PREEMPT] = "preempt",
+};
+
+char *trace_reason_name(int64_t reason) {
+    if (reason < 0 || reason > TRACE_REASON_PREEMPT) {
+        return "unknown";
+    }
+
+    return trace_reason_names[reason];
+}
+
+static trace_buf_t *trace_buf_new() {
+    trace_buf_t *buf = mallocz(sizeof(trace_buf_t));
+    buf->events = mallocz(sizeof(trace_event_t) * TRACE_BUF_SIZE);
+    return buf;
+}
+
+/**
+ * 非 processor 线程首次写入事件时注册独立的 ring buffer, 超过 TRACE_BUF_MAX 之后该线程的事件会被丢弃
+ */
+static trace_buf_t *trace_thread_buf(n_processor_t *p) {
+    if (!tls_trace_buf && !tls_trace_full) {
+        int slot = atomic_fetch_add(&trace_buf_count, 1);
+        if (slot >= TRACE_BUF_MAX) {
+            tls_trace_full = true;
+            return NULL;
+        }
+
+        trace_buf_t *buf = trace_buf_new();
+        snprintf(buf->name, sizeof(buf->name), "runtime thread %d", slot);
+        atomic_store_explicit(&trace_bufs[slot], buf, memory_order_release);
+        tls_trace_buf = buf;
+    }
+
+    // blocking 工作线程在绑定 processor 之前就可能写入事件, 绑定之后再按照 processor index 命名
+    if (tls_trace_buf && p && !tls_trace_named) {
+        snprintf(tls_trace_buf->name, sizeof(tls_trace_buf->name), "blocking processor %d", p->index);
+        tls_trace_named = true;
+    }
+
+    return tls_trace_buf;
+}
+
+void trace_record(trace_kind_t kind, int64_t co_id, int64_t arg) {
+    n_processor_t *p = processor_get();
+    trace_buf_t *buf = p && p->index < cpu_count ? trace_bufs[p->index] : trace_thread_buf(p);
+    if (!buf) {
+        return;
+    }
+
+    uint64_t index = atomic_fetch_add_explicit(&buf->head, 1, memory_order_relaxed);
+    trace_event_t *event = &buf->events[index & (TRACE_BUF_SIZE - 1)];
+    event->co_id = co_id;
+    event->arg = arg;
+    event->kind = kind;
+    event->ts = uv_hrtime();
+}
+
+/**
+ * 注册失败的线程同样会增加 trace_buf_count, 所以需要限制在 TRACE_BUF_MAX 以内
+ */
+static int trace_buf_count_load() {
+    int count = atomic_load(&trace_buf_count);
+    return count > TRACE_BUF_MAX ? TRACE_BUF_MAX : count;
+}
+
+void rt_trace_start() {
+    if (atomic_load(&trace_enabled)) {
+        return;
+    }
+
+    if (atomic_load(&trace_buf_count) == 0) {
+        for (int i = 0; i < cpu_count; ++i) {
+            trace_buf_t *buf = trace_buf_new();
+            snprintf(buf->name, sizeof(buf->name), "processor %d", i);
+            trace_bufs[i] = buf;
+        }
+        atomic_store(&trace_buf_count, cpu_count);
+    } else {
+        int count = trace_buf_count_load();
+        for (int i = 0; i < count; ++i) {
+            trace_buf_t *buf = atomic_load(&trace_bufs[i]);
+            if (!buf) {
+                continue;
+            }
+
+            memset(buf->events, 0, sizeof(trace_event_t) * TRACE_BUF_SIZE);
+            atomic_store(&buf->head, 0);
+        }
+    }
+
+    trace_start_at = uv_hrtime();
+    atomic_store_explicit(&trace_enabled, true, memory_order_release);
+    DEBUGF("[runtime.rt_trace_start] trace enabled, buf_count=%d", trace_buf_count_load());
+}
+
+static void trace_write_event(FILE *f, int tid, trace_event_t *event) {
+    double ts = (double) (event->ts - trace_start_at) / 1000;
+
+    switch (event->kind) {
+        case TRACE_CO_CREATE:
+            fprintf(f, ",\n{\"name\":\"create\",\"ph\":\"i\",\"s\":\"t\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"args\":{\"co\":%ld}}",
+                    tid, ts, event->co_id);
+            break;
+        case TRACE_CO_RESUME:
+            fprintf(f, ",\n{\"name\":\"co %ld\",\"cat\":\"sched\",\"ph\":\"B\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"args\":{\"co\":%ld}}",
+                    event->co_id, tid, ts, event->co_id);
+            break;
+        case TRACE_CO_YIELD:
+        case TRACE_CO_BLOCK:
+        case TRACE_CO_UNBLOCK:
+            fprintf(f,
+                    ",\n{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"t\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"args\":{\"co\":%ld,\"reason\":\"%s\"}}",
+                    event->kind == TRACE_CO_YIELD ? "yield" : (event->kind == TRACE_CO_BLOCK ? "block" : "unblock"), tid, ts,
+                    event->co_id, trace_reason_name(event->arg));
+            break;
+        case TRACE_CO_EXIT:
+            fprintf(f, ",\n{\"name\":\"exit\",\"ph\":\"i\",\"s\":\"t\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"args\":{\"co\":%ld}}",
+                    tid, ts, event->co_id);
+            break;
+        case TRACE_P_STATUS:
+            fprintf(f, ",\n{\"name\":\"p%d status\",\"ph\":\"C\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"args\":{\"status\":%ld}}",
+                    tid, tid, ts, event->arg);
+            break;
+        case TRACE_IO_BEGIN:
+        case TRACE_STW_BEGIN:
+        case TRACE_GC_MARK_BEGIN:
+        case TRACE_GC_SWEEP_BEGIN: {
+            char *name = event->kind == TRACE_IO_BEGIN ? "io_run" : (event->kind == TRACE_STW_BEGIN ? "stw" : (event->kind == TRACE_GC_MARK_BEGIN ? "gc_mark" : "gc_sweep"));
+            fprintf(f, ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"B\",\"pid\":1,\"tid\":%d,\"ts\":%.3f}", name,
+                    event->kind == TRACE_IO_BEGIN ? "io" : "gc", tid, ts);
+            break;
+        }
+        case TRACE_CO_STOP:
+        case TRACE_IO_END:
+        case TRACE_STW_END:
+        case TRACE_GC_MARK_END:
+        case TRACE_GC_SWEEP_END:
+            fprintf(f, ",\n{\"ph\":\"E\",\"pid\":1,\"tid\":%d,\"ts\":%.3f}", tid, ts);
+            break;
+        default:
+            break;
+    }
+}
+
+static bool trace_is_begin(uint16_t kind) {
+    return kind == TRACE_CO_RESUME || kind == TRACE_IO_BEGIN || kind == TRACE_STW_BEGIN || kind == TRACE_GC_MARK_BEGIN ||
+           kind == TRACE_GC_SWEEP_BEGIN;
+}
+
+static bool trace_is_end(uint16_t kind) {
+    return kind == TRACE_CO_STOP || kind == TRACE_IO_END || kind == TRACE_STW_END || kind == TRACE_GC_MARK_END ||
+           kind == TRACE_GC_SWEEP_END;
+}
+
+/**
+ * 调用前需要关闭 trace_enabled
+ * @return 写入失败时返回 false
+ */
+static bool trace_flush(char *path) {
+    // 等待已经占用 slot 的写入方完成写入
+    usleep(TRACE_FLUSH_WAIT * 1000);
+
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        return false;
+    }
+
+    fprintf(f, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    fprintf(f, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"nature\"}}");
+    int count = trace_buf_count_load();
+    for (int i = 0; i < count; ++i) {
+        trace_buf_t *buf = atomic_load(&trace_bufs[i]);
+        if (!buf) {
+            continue;
+        }
+
+        fprintf(f, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}", i,
+                buf->name);
+    }
+
+    for (int i = 0; i < count; ++i) {
+        trace_buf_t *buf = atomic_load(&trace_bufs[i]);
+        if (!buf) {
+            continue;
+        }
+
+        uint64_t head = atomic_load(&buf->head);
+        uint64_t start = head > TRACE_BUF_SIZE ? head - TRACE_BUF_SIZE : 0;
+
+        // ring buffer 被覆盖后开头可能存在没有 begin 的 end 事件, 需要跳过
+        int64_t depth = 0;
+        for (uint64_t j = start; j < head; ++j) {
+            trace_event_t *event = &buf->events[j & (TRACE_BUF_SIZE - 1)];
+            if (event->ts < trace_start_at) {
+                continue;
+            }
+
+            if (trace_is_begin(event->kind)) {
+                depth++;
+            } else if (trace_is_end(event->kind)) {
+                if (depth == 0) {
+                    continue;
+                }
+                depth--;
+            }
+
+            trace_write_event(f, i, event);
+        }
+    }
+
+    fprintf(f, "\n]}\n");
+    fclose(f);
+    return true;
+}
+
+void rt_trace_stop(n_string_t *path) {
+    if (!atomic_exchange(&trace_enabled, false)) {
+        rti_throw("trace not started", false);
+        return;
+    }
+
+    char *path_str = rt_string_ref(path);
+    DEBUGF("[runtime.rt_trace_stop] trace disabled, will flush to %s", path_str);
+    if (!trace_flush(path_str)) {
+        rti_throw(tlsprintf("open trace file %s failed: %s", path_str, strerror(errno)), false);
+        return;
+    }
+}
+
+static void trace_exit() {
+    if (!atomic_exchange(&trace_enabled, false)) {
+        return;
+    }
+
+    if (!trace_flush(trace_env_path)) {
+        fprintf(stderr, "nature: write trace to %s failed: %s\n", trace_env_path, strerror(errno));
+    }
+}
+
+void trace_init() {
+    char *path = getenv(TRACE_ENV);
+    if (!path || path[0] == '\0') {
+        return;
+    }
+
+    trace_env_path = path;
+    rt_trace_start();
+    atexit(trace_exit);
+}
@@ -0,0 +1,92 @@
+#ifndef NATURE_TRACE_H
+#define NATURE_TRACE_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "runtime.h"
+
+#define TRACE_ENV "NATURE_TRACE" // trace 输出文件路径, 设置后从启动开始 trace, 进程退出时写入
+#define TRACE_BUF_SIZE 65536 // 每个 ring buffer 保存的事件数量, 必须是 2 的幂, 写满后覆盖最早的事件
+#define TRACE_FLUSH_WAIT 1 // 关闭 trace 后等待正在写入的事件完成, 单位 ms
+#define TRACE_SYSTEM_THREAD_MAX 64 // 除 processor 之外的 gc/sysmon 等线程的 ring buffer 数量上限
+
+typedef enum {
+    TRACE_CO_CREATE = 1,
+    TRACE_CO_RESUME, // coroutine 开始运行
+    TRACE_CO_STOP, // coroutine 从 resume 中返回
+    TRACE_CO_YIELD,
+    TRACE_CO_BLOCK,
+    TRACE_CO_UNBLOCK,
+    TRACE_CO_EXIT,
+    TRACE_P_STATUS,
+    TRACE_IO_BEGIN,
+    TRACE_IO_END,
+    TRACE_STW_BEGIN,
+    TRACE_STW_END,
+    TRACE_GC_MARK_BEGIN,
+    TRACE_GC_MARK_END,
+    TRACE_GC_SWEEP_BEGIN,
+    TRACE_GC_SWEEP_END,
+} trace_kind_t;
+
+// coroutine yield/block 的原因, 同时记录在 co->wait_reason 中用于 unblock 事件
+typedef enum {
+    TRACE_REASON_NONE = 0,
+    TRACE_REASON_IO,
+    TRACE_REASON_CHAN,
+    TRACE_REASON_MUTEX,
+    TRACE_REASON_SLEEP,
+    TRACE_REASON_SELECT,
+    TRACE_REASON_AWAIT,
+    TRACE_REASON_PREEMPT,
+} trace_reason_t;
+
+typedef struct {
+    uint64_t ts; // uv_hrtime, 为 0 表示未写入
+    int64_t co_id;
+    int64_t arg;
+    uint16_t kind;
+} trace_event_t;
+
+/**
+ * 每个线程独占一个 ring buffer, 在导出的 trace 中对应一个 tid, 保证 B/E 事件在同一个线程内正确嵌套
+ */
+typedef struct {
+    trace_event_t *events;
+    ATOMIC uint64_t head; // 写入方通过 fetch_add 占用 slot, 避免被同一线程中的信号处理函数打断时覆盖
+    char name[32]; // 导出时的 thread_name
+} trace_buf_t;
+
+extern ATOMIC bool trace_enabled;
+
+char *trace_reason_name(int64_t reason);
+
+void trace_record(trace_kind_t kind, int64_t co_id, int64_t arg);
+
+/**
+ * 未开启 trace 时仅有一次 atomic load
+ */
+static inline void trace_event(trace_kind_t kind, int64_t co_id, int64_t arg) {
+    if (__builtin_expect(atomic_load_explicit(&trace_enabled, memory_order_acquire), 0)) {
+        trace_record(kind, co_id, arg);
+    }
+}
+
+/**
+ * 读取 NATURE_TRACE 环境变量, 需要在 processor 创建完成后调用
+ */
+void trace_init();
+
+/**
+ * 开始记录事件, 已经开启时不做处理
+ */
+void rt_trace_start();
+
+/**
+ * 停止记录并将 ring buffer 中的事件以 chrome trace json 格式写入到 path 中, 可以直接使用 perfetto ui 打开
+ */
+void rt_trace_stop(n_string_t *path);
+
+#endif // NATURE_TRACE_H
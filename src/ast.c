@@ -275,6 +275,14 @@ static ast_macro_type_eq_expr_t *ast_type_eq_expr_copy(module_t *m, ast_macro_ty
     return expr;
 }
 
+static ast_macro_atomic_expr_t *ast_atomic_expr_copy(module_t *m, ast_macro_atomic_expr_t *temp) {
+    ast_macro_atomic_expr_t *expr = COPY_NEW(ast_macro_atomic_expr_t, temp);
+    expr->target = *ast_expr_copy(m, &temp->target);
+    expr->value = ast_expr_copy(m, temp->value);
+    expr->expected = ast_expr_copy(m, temp->expected);
+    return expr;
+}
+
 static ast_is_expr_t *ast_is_expr_copy(module_t *m, ast_is_expr_t *temp) {
     ast_is_expr_t *is_expr = COPY_NEW(ast_is_expr_t, temp);
     is_expr->src = *ast_expr_copy(m, &temp->src);
@@ -588,6 +596,10 @@ ast_expr_t *ast_expr_copy(module_t *m, ast_expr_t *temp) {
             expr->value = ast_type_eq_expr_copy(m, temp->value);
             break;
         }
+        case AST_MACRO_EXPR_ATOMIC: {
+            expr->value = ast_atomic_expr_copy(m, temp->value);
+            break;
+        }
         case AST_EXPR_SELECT: {
             expr->value = ast_select_expr_copy(m, temp->value);
             break;
@@ -877,7 +889,8 @@ ast_fndef_t *ast_fndef_copy(module_t *m, ast_fndef_t *temp) {
     fndef->return_type = type_copy(m, temp->return_type);
     fndef->params = ast_fn_formals_copy(m, temp->params);
     fndef->type = type_copy(m, temp->type);
-    fndef->capture_exprs = temp->capture_exprs;
+    // infer 会改写 capture_exprs 中的 ident, 泛型函数的多个特化实例之间不能共享
+    fndef->capture_exprs = temp->capture_exprs ? ast_list_expr_copy(m, temp->capture_exprs) : NULL;
     fndef->fn_name = temp->fn_name;
     fndef->fn_name_with_pkg = temp->fn_name_with_pkg;
     fndef->rel_path = temp->rel_path;
@@ -29,6 +29,7 @@ typedef enum {
     AST_MACRO_EXPR_REFLECT_HASH,
     AST_MACRO_EXPR_TYPE_EQ,
     AST_MACRO_EXPR_DEFAULT,
+    AST_MACRO_EXPR_ATOMIC,
     AST_MACRO_ASYNC,
 
     AST_EXPR_NEW, // new person
@@ -215,6 +216,35 @@ typedef struct {
     type_t target_type;
 } ast_macro_reflect_hash_expr_t;
 
+typedef enum {
+    ATOMIC_OP_LOAD = 1,
+    ATOMIC_OP_STORE,
+    ATOMIC_OP_ADD,
+    ATOMIC_OP_SWAP,
+    ATOMIC_OP_CAS,
+} atomic_op_t;
+
+typedef enum {
+    ATOMIC_ORDER_RELAXED = 1,
+    ATOMIC_ORDER_ACQUIRE,
+    ATOMIC_ORDER_RELEASE,
+    ATOMIC_ORDER_ACQ_REL,
+    ATOMIC_ORDER_SEQ_CST,
+} atomic_order_t;
+
+/**
+ * @atomic_add(counter.n, 1, acq_rel)
+ * target 必须是可寻址的左值(struct field/vec element/var), value/expected 根据 op 可选
+ */
+typedef struct {
+    atomic_op_t op;
+    atomic_order_t order;
+    ast_expr_t target;
+    ast_expr_t *value; // store/add/swap/cas(new)
+    ast_expr_t *expected; // cas
+    type_t target_type;
+} ast_macro_atomic_expr_t;
+
 // 调用函数
 typedef struct {
     type_t return_type; // call return type
@@ -282,6 +282,25 @@ amd64_opcode_inst_t lea_r64_m = {"lea", "lea", 0, {0x8D}, {OPCODE_EXT_REX_W, OPC
 
 amd64_opcode_inst_t syscall_inst = {"syscall_inst", "syscall_inst", 0, {0x0F, 0x05}, {}, {}};
 
+// atomic ------------------------------------------------------------------------------------------------------
+// lock xadd [mem], r64
+amd64_opcode_inst_t lock_xadd_rm64_r64 = {"xadd", "lock xadd", 0xF0, {0x0F, 0xC1}, {OPCODE_EXT_REX_W, OPCODE_EXT_SLASHR},
+                                          {{OPERAND_TYPE_RM64, ENCODING_TYPE_MODRM_RM},
+                                           {OPERAND_TYPE_R64, ENCODING_TYPE_MODRM_REG}}};
+
+// xchg 的操作数为内存时隐含 lock 语义
+amd64_opcode_inst_t xchg_rm64_r64 = {"xchg", "xchg", 0, {0x87}, {OPCODE_EXT_REX_W, OPCODE_EXT_SLASHR},
+                                     {{OPERAND_TYPE_RM64, ENCODING_TYPE_MODRM_RM},
+                                      {OPERAND_TYPE_R64, ENCODING_TYPE_MODRM_REG}}};
+
+// lock cmpxchg [mem], r64, 隐式使用 rax 作为 expected 并返回 old value
+amd64_opcode_inst_t lock_cmpxchg_rm64_r64 = {"cmpxchg", "lock cmpxchg", 0xF0, {0x0F, 0xB1},
+                                             {OPCODE_EXT_REX_W, OPCODE_EXT_SLASHR},
+                                             {{OPERAND_TYPE_RM64, ENCODING_TYPE_MODRM_RM},
+                                              {OPERAND_TYPE_R64, ENCODING_TYPE_MODRM_REG}}};
+
+amd64_opcode_inst_t mfence = {"mfence", "mfence", 0, {0x0F, 0xAE, 0xF0}, {}, {}};
+
 // TODO 什么时候使用 near 什么时候使用 far?
 amd64_opcode_inst_t ret = {"ret", "ret", 0, {0xC3}, {}, {}};
 
@@ -804,6 +823,10 @@ void amd64_opcode_init() {
     // 收集所有指令，进行注册
     opcode_tree_build(&lea_r64_m);
     opcode_tree_build(&syscall_inst);
+    opcode_tree_build(&lock_xadd_rm64_r64);
+    opcode_tree_build(&xchg_rm64_r64);
+    opcode_tree_build(&lock_cmpxchg_rm64_r64);
+    opcode_tree_build(&mfence);
     opcode_tree_build(&call_rm64);
     opcode_tree_build(&call_rel32);
     opcode_tree_build(&jmp_rel8);
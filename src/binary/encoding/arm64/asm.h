@@ -84,6 +84,13 @@ typedef enum {
     R_FCVTZS,
     R_FCVTZU,
     R_MVN,
+
+    R_LDADDAL,
+    R_SWPAL,
+    R_CASAL,
+    R_DMB,
+    R_LDAXR,
+    R_STLXR,
 } arm64_asm_raw_opcode_t;
 
 static char *arm64_raw_op_names[] = {
@@ -163,6 +170,12 @@ static char *arm64_raw_op_names[] = {
         [R_FCVTZS] = "fcvtzs",
         [R_FCVTZU] = "fcvtzu",
         [R_MVN] = "mvn",
+        [R_LDADDAL] = "ldaddal",
+        [R_SWPAL] = "swpal",
+        [R_CASAL] = "casal",
+        [R_DMB] = "dmb",
+        [R_LDAXR] = "ldaxr",
+        [R_STLXR] = "stlxr",
 };
 
 typedef enum {
@@ -253,6 +266,12 @@ typedef enum {
     FCVTZU,
     MVN,
     MRS,
+    LDADDAL,
+    SWPAL,
+    CASAL,
+    DMB,
+    LDAXR,
+    STLXR,
 } arm64_asm_opcode_t;
 
 typedef enum {
@@ -538,6 +557,16 @@ typedef struct {
 
 #define W_MRS(rt, sysreg) (0xd5300000U | ((sysreg) << 5) | (rt))
 
+// LSE 原子指令, 仅支持 64 位, acquire + release 语义
+#define W_LDADDAL(rs, rt, rn) (0xF8E00000U | ((rs) << 16) | ((rn) << 5) | (rt))
+#define W_SWPAL(rs, rt, rn) (0xF8E08000U | ((rs) << 16) | ((rn) << 5) | (rt))
+#define W_CASAL(rs, rt, rn) (0xC8E0FC00U | ((rs) << 16) | ((rn) << 5) | (rt))
+#define W_DMB(crm) (0xD50330BFU | ((crm) << 8))
+
+// 独占访问指令, ARMv8.0 即可用, 作为不支持 LSE 时的 fallback, 仅支持 64 位
+#define W_LDAXR(rt, rn) (0xC85FFC00U | ((rn) << 5) | (rt))
+#define W_STLXR(rs, rt, rn) (0xC800FC00U | ((rs) << 16) | ((rn) << 5) | (rt))
+
 #define W_CSINC(sz, rd, rn, rm, cond) (0x1a800400U | ((sz) << 31) | ((rm) << 16) | ((cond) << 12) | ((rn) << 5) | (rd))
 
 #define W_B(offset) (0x14000000U | ((offset) & ((1U << 26) - 1)))
@@ -513,6 +513,51 @@ static uint32_t asm_mrs(arm64_asm_inst_t *inst) {
     return 0;
 }
 
+/**
+ * ldaddal/swpal/casal rs, rt, [rn], rn 不支持 offset
+ */
+static uint32_t asm_atomic(arm64_asm_inst_t *inst) {
+    arm64_asm_operand_t *opr1 = inst->operands[0];
+    arm64_asm_operand_t *opr2 = inst->operands[1];
+    arm64_asm_operand_t *opr3 = inst->operands[2];
+    assert(opr3->indirect.offset == 0 && opr3->indirect.prepost == 0);
+
+    uint32_t rs = opr1->reg.index;
+    uint32_t rt = opr2->reg.index;
+    uint32_t rn = opr3->indirect.reg->index;
+    switch (inst->opcode) {
+        case LDADDAL:
+            return W_LDADDAL(rs, rt, rn);
+        case SWPAL:
+            return W_SWPAL(rs, rt, rn);
+        case CASAL:
+            return W_CASAL(rs, rt, rn);
+        default:
+            return 0;
+    }
+}
+
+/**
+ * ldaxr rt, [rn] / stlxr ws, rt, [rn], rn 不支持 offset
+ */
+static uint32_t asm_exclusive(arm64_asm_inst_t *inst) {
+    if (inst->opcode == LDAXR) {
+        arm64_asm_operand_t *opr2 = inst->operands[1];
+        assert(opr2->indirect.offset == 0 && opr2->indirect.prepost == 0);
+        return W_LDAXR(inst->operands[0]->reg.index, opr2->indirect.reg->index);
+    }
+
+    arm64_asm_operand_t *opr3 = inst->operands[2];
+    assert(opr3->indirect.offset == 0 && opr3->indirect.prepost == 0);
+    return W_STLXR(inst->operands[0]->reg.index, inst->operands[1]->reg.index, opr3->indirect.reg->index);
+}
+
+// dmb 操作数为 CRm, ish = 0xb, ishld = 0x9
+static uint32_t asm_dmb(arm64_asm_inst_t *inst) {
+    arm64_asm_operand_t *opr1 = inst->operands[0];
+    return W_DMB((uint32_t) opr1->immediate);
+}
+
 static uint32_t asm_f_ldrstr(arm64_asm_inst_t *inst) {
     arm64_asm_operand_t *opr1 = inst->operands[0];
     arm64_asm_operand_t *opr2 = inst->operands[1];
@@ -829,6 +874,12 @@ arm64_opr_flags_list arm64_opcode_map[] = {
                               &(arm64_opr_flags) {MVN, {R32, R32}}, // 32位寄存器
                               &(arm64_opr_flags) {MVN, {R64, R64}}, // 64位寄存器
                       }},
+        [R_LDADDAL] = {1, (arm64_opr_flags *[]) {&(arm64_opr_flags) {LDADDAL, {R64, R64, IND}}}},
+        [R_SWPAL] = {1, (arm64_opr_flags *[]) {&(arm64_opr_flags) {SWPAL, {R64, R64, IND}}}},
+        [R_CASAL] = {1, (arm64_opr_flags *[]) {&(arm64_opr_flags) {CASAL, {R64, R64, IND}}}},
+        [R_DMB] = {1, (arm64_opr_flags *[]) {&(arm64_opr_flags) {DMB, {IMM}}}},
+        [R_LDAXR] = {1, (arm64_opr_flags *[]) {&(arm64_opr_flags) {LDAXR, {R64, IND}}}},
+        [R_STLXR] = {1, (arm64_opr_flags *[]) {&(arm64_opr_flags) {STLXR, {R32, R64, IND}}}},
 };
 
 static bool match_operand_flags(arm64_asm_operand_t *operand, int flag) {
@@ -1016,6 +1067,12 @@ static arm64_opcode_handle_fn arm64_opcode_handle_table[] = {
         [FCVTZS] = asm_f_2r,
         [FCVTZU] = asm_f_2r,
         [MVN] = asm_mvn,
+        [LDADDAL] = asm_atomic,
+        [SWPAL] = asm_atomic,
+        [CASAL] = asm_atomic,
+        [DMB] = asm_dmb,
+        [LDAXR] = asm_exclusive,
+        [STLXR] = asm_exclusive,
 };
 
 uint32_t arm64_asm_inst_encoding(arm64_asm_inst_t *inst, uint8_t *data_count) {
@@ -199,6 +199,13 @@ typedef enum {
     RV_FCVT_LU_S,
     RV_FCVT_D_S,
     RV_FCVT_S_D,
+
+    // A 扩展, 统一使用 aq+rl 语义
+    RV_AMOADD_D,
+    RV_AMOSWAP_D,
+    RV_LR_D,
+    RV_SC_D,
+    RV_FENCE,
 } riscv64_asm_raw_opcode_t;
 
 typedef enum {
@@ -361,6 +368,12 @@ static char *riscv64_raw_op_names[] = {
         "fcvt.lu.s",
         "fcvt.d.s",
         "fcvt.s.d",
+
+        "amoadd.d.aqrl",
+        "amoswap.d.aqrl",
+        "lr.d.aqrl",
+        "sc.d.aqrl",
+        "fence",
         NULL,
 };
 
@@ -497,6 +510,12 @@ typedef enum {
     O_FCVT_LU_S,
     O_FCVT_D_S,
     O_FCVT_S_D,
+
+    O_AMOADD_D,
+    O_AMOSWAP_D,
+    O_LR_D,
+    O_SC_D,
+    O_FENCE,
 } riscv64_asm_opcode_t;
 
 
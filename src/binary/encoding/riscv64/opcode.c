@@ -160,6 +160,12 @@ riscv64_opr_flags_list riscv64_opcode_map[] = {
                              }},
         [RV_FCVT_D_S] = {1, (riscv64_opr_flags *[]) {&(riscv64_opr_flags) {O_FCVT_D_S, {RISCV64_F64, RISCV64_F64}}}},
         [RV_FCVT_S_D] = {1, (riscv64_opr_flags *[]) {&(riscv64_opr_flags) {O_FCVT_S_D, {RISCV64_F64, RISCV64_F64}}}},
+
+        [RV_AMOADD_D] = {1, (riscv64_opr_flags *[]) {&(riscv64_opr_flags) {O_AMOADD_D, {RISCV64_R64, RISCV64_R64, RISCV64_IND}}}},
+        [RV_AMOSWAP_D] = {1, (riscv64_opr_flags *[]) {&(riscv64_opr_flags) {O_AMOSWAP_D, {RISCV64_R64, RISCV64_R64, RISCV64_IND}}}},
+        [RV_LR_D] = {1, (riscv64_opr_flags *[]) {&(riscv64_opr_flags) {O_LR_D, {RISCV64_R64, RISCV64_IND}}}},
+        [RV_SC_D] = {1, (riscv64_opr_flags *[]) {&(riscv64_opr_flags) {O_SC_D, {RISCV64_R64, RISCV64_R64, RISCV64_IND}}}},
+        [RV_FENCE] = {1, (riscv64_opr_flags *[]) {&(riscv64_opr_flags) {O_FENCE, {RISCV64_IMM, RISCV64_IMM}}}},
 };
 
 
@@ -797,6 +803,46 @@ static unsigned char *asm_ecall(riscv64_asm_inst_t *inst) {
     return inst->opcode_data;
 }
 
+/**
+ * amoadd.d.aqrl rd, rs2, (rs1) / sc.d.aqrl rd, rs2, (rs1)
+ */
+static unsigned char *asm_amo(riscv64_asm_inst_t *inst) {
+    int rd = inst->operands[0]->reg.index;
+    int rs2 = inst->operands[1]->reg.index;
+    assert(inst->operands[2]->indirect.offset == 0);
+    int rs1 = inst->operands[2]->indirect.reg->index;
+    switch (inst->opcode) {
+        case O_AMOADD_D:
+            W_AMOADD_D(rd, rs2, rs1);
+            return inst->opcode_data;
+        case O_AMOSWAP_D:
+            W_AMOSWAP_D(rd, rs2, rs1);
+            return inst->opcode_data;
+        case O_SC_D:
+            W_SC_D(rd, rs2, rs1);
+            return inst->opcode_data;
+        default:
+            break;
+    }
+
+    assert(false);
+    return NULL;
+}
+
+static unsigned char *asm_lr(riscv64_asm_inst_t *inst) {
+    int rd = inst->operands[0]->reg.index;
+    assert(inst->operands[1]->indirect.offset == 0);
+    int rs1 = inst->operands[1]->indirect.reg->index;
+    W_LR_D(rd, rs1);
+    return inst->opcode_data;
+}
+
+// fence pred, succ, 操作数为 iorw 位图
+static unsigned char *asm_fence(riscv64_asm_inst_t *inst) {
+    W_FENCE(inst->operands[0]->immediate, inst->operands[1]->immediate);
+    return inst->opcode_data;
+}
+
 static unsigned char *asm_3fr(riscv64_asm_inst_t *inst) {
     assert(inst->operands[0]->type == RISCV64_ASM_OPERAND_FREG);
     assert(inst->operands[1]->type == RISCV64_ASM_OPERAND_FREG);
@@ -1273,6 +1319,12 @@ static riscv64_opcode_handle_fn riscv64_opcode_handle_table[] = {
         [O_FCVT_LU_S] = asm_if,
         [O_FCVT_D_S] = asm_2fr,
         [O_FCVT_S_D] = asm_2fr,
+
+        [O_AMOADD_D] = asm_amo,
+        [O_AMOSWAP_D] = asm_amo,
+        [O_LR_D] = asm_lr,
+        [O_SC_D] = asm_amo,
+        [O_FENCE] = asm_fence,
 };
 
 uint8_t *riscv64_asm_inst_encoding(riscv64_asm_inst_t *inst, closure_t *c) {
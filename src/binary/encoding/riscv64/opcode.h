@@ -102,6 +102,13 @@ static inline void make_code32(riscv64_asm_inst_t *inst, uint32_t *buf, int len)
 #define W_BXX(xx, rs1, rs2, ofs) MAKE_CODE32(inst, STYPE(0, rs2, rs1, xx, 0x63) | SWIZZLE_BXX(ofs))
 #define W_ECALL() MAKE_CODE32(inst, UTYPE(0, 0, 0x73))
 
+// funct7 = funct5 << 2 | aq << 1 | rl
+#define W_AMOADD_D(rd, rs2, rs1) MAKE_CODE32(inst, RTYPE(0x03, rs2, rs1, 0x03, rd, 0x2f))
+#define W_AMOSWAP_D(rd, rs2, rs1) MAKE_CODE32(inst, RTYPE(0x07, rs2, rs1, 0x03, rd, 0x2f))
+#define W_LR_D(rd, rs1) MAKE_CODE32(inst, RTYPE(0x0b, 0, rs1, 0x03, rd, 0x2f))
+#define W_SC_D(rd, rs2, rs1) MAKE_CODE32(inst, RTYPE(0x0f, rs2, rs1, 0x03, rd, 0x2f))
+#define W_FENCE(pred, succ) MAKE_CODE32(inst, (((pred) << 24) | ((succ) << 20) | 0x0f))
+
 #define W_FADD_D(rd, rs1, rs2) MAKE_CODE32(inst, RTYPE(0x01, rs2, rs1, 0x07, rd, 0x53))
 #define W_FSUB_D(rd, rs1, rs2) MAKE_CODE32(inst, RTYPE(0x05, rs2, rs1, 0x07, rd, 0x53))
 #define W_FMUL_D(rd, rs1, rs2) MAKE_CODE32(inst, RTYPE(0x09, rs2, rs1, 0x07, rd, 0x53))
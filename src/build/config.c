@@ -29,6 +29,8 @@ char BUILD_OUTPUT[PATH_MAX] = "";
 char USE_LD[1024] = "";
 char LDFLAGS[1024] = "";
 
+bool BUILD_ARM64_LSE = false;
+
 char *WORKDIR; // 执行 shell 命令所在的目录(import 搜索将会基于该目录进行文件搜索)
 char *BASE_NS; // 最后一级目录的名称，也可以自定义
 char *TEMP_DIR; // 链接临时目录
@@ -32,6 +32,8 @@ extern char *TEMP_DIR; // 链接临时目录
 extern char USE_LD[1024]; // 自定义链接器
 extern char LDFLAGS[1024]; // 自定义链接器参数
 
+extern bool BUILD_ARM64_LSE; // arm64 原子指令使用 LSE(ARMv8.1+), 默认使用 ldaxr/stlxr 循环以兼容 ARMv8.0
+
 extern char *BUILD_ENTRY; // nature build {test/main.n} 花括号包起来的这部分
 extern char SOURCE_PATH[PATH_MAX]; // /opt/test/main.n 的绝对路径
 
@@ -166,6 +166,10 @@ string lir_opcode_to_string[] = {
         [LIR_OPCODE_FN_BEGIN] = "FN_BEGIN",
         [LIR_OPCODE_FN_END] = "FN_END",
         [LIR_OPCODE_SAFEPOINT] = "SAFEPOINT",
+        [LIR_OPCODE_ATOMIC_XADD] = "XADD  ",
+        [LIR_OPCODE_ATOMIC_XCHG] = "XCHG  ",
+        [LIR_OPCODE_ATOMIC_CAS] = "CAS   ",
+        [LIR_OPCODE_FENCE] = "FENCE ",
 };
 
 void debug_parser(int line, char *token) {
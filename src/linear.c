@@ -1448,10 +1448,18 @@ static void linear_select(module_t *m, ast_select_stmt_t *select_stmt) {
         n_chan_t *chan;
         void *msg_ptr;
     } scase;*/
+    // 单个 case + default 的 select 直接 lower 为 try send/recv, 不需要构造 scase 数组
+    bool try_single = cases_count == 1 && select_stmt->has_default;
+    lir_operand_t *single_chan = NULL;
+    lir_operand_t *single_msg_ptr = NULL;
+
     // 创建栈空间存储 scase 数据, send 放在前面，recv 放在后面
-    type_t type_arr = type_array_new(TYPE_ANYPTR, cases_count * 2);
-    // 实际上 c 语言不能接收一个数组作为参数，所以传递参数时需要转换为指针
-    lir_operand_t *scase_target = temp_var_operand_with_alloc(m, type_arr);
+    lir_operand_t *scase_target = NULL;
+    if (!try_single) {
+        type_t type_arr = type_array_new(TYPE_ANYPTR, cases_count * 2);
+        // 实际上 c 语言不能接收一个数组作为参数，所以传递参数时需要转换为指针
+        scase_target = temp_var_operand_with_alloc(m, type_arr);
+    }
     int64_t send_offset = 0;
     int64_t recv_offset = select_stmt->send_count * POINTER_SIZE * 2;
 
@@ -1480,7 +1488,16 @@ static void linear_select(module_t *m, ast_select_stmt_t *select_stmt) {
         assert(chan_expr->type.kind == TYPE_CHAN);
         lir_operand_t *chan_target = linear_expr(m, *chan_expr, NULL);
 
-        if (select_case->is_recv) {
+        if (try_single) {
+            single_chan = chan_target;
+            if (select_case->is_recv) {
+                single_msg_ptr = select_case->recv_var ? lea_operand_pointer(m, recv_target)
+                                                       : integer_operand(0, TYPE_ANYPTR);
+            } else {
+                ast_expr_t *msg_expr = ct_list_value(args, 1);
+                single_msg_ptr = lea_operand_pointer(m, linear_expr(m, *msg_expr, NULL));
+            }
+        } else if (select_case->is_recv) {
             casi = recv_offset / (POINTER_SIZE * 2);
 
             lir_operand_t *dst_chan = indirect_addr_operand(m, type_kind_new(TYPE_ANYPTR), scase_target, recv_offset);
@@ -1522,11 +1539,17 @@ static void linear_select(module_t *m, ast_select_stmt_t *select_stmt) {
     // int rt_chan_select(scase *cases, int16_t sends_count, int16_t recvs_count, bool _try)
     // select has default, _try = true
     lir_operand_t *chan_select_case_index = temp_var_operand(m, type_kind_new(TYPE_INT));
-    lir_var_t *scase_var = scase_target->value;
-    scase_var->type = type_kind_new(TYPE_ANYPTR);
-    push_rt_call(m, RT_CALL_CHAN_SELECT, chan_select_case_index, 4, scase_target,
-                 int16_operand(select_stmt->send_count),
-                 int16_operand(select_stmt->recv_count), bool_operand(select_stmt->has_default));
+    if (try_single) {
+        // int rt_chan_select_try_send/recv(n_chan_t *chan, void *msg_ptr), 返回 0 或 -1(default)
+        char *try_call = select_stmt->send_count > 0 ? RT_CALL_CHAN_SELECT_TRY_SEND : RT_CALL_CHAN_SELECT_TRY_RECV;
+        push_rt_call(m, try_call, chan_select_case_index, 2, single_chan, single_msg_ptr);
+    } else {
+        lir_var_t *scase_var = scase_target->value;
+        scase_var->type = type_kind_new(TYPE_ANYPTR);
+        push_rt_call(m, RT_CALL_CHAN_SELECT, chan_select_case_index, 4, scase_target,
+                     int16_operand(select_stmt->send_count),
+                     int16_operand(select_stmt->recv_count), bool_operand(select_stmt->has_default));
+    }
 
     /*int i = rt_select()
 	beq i != 1 -> select_case_1.end
@@ -2617,6 +2640,115 @@ static lir_operand_t *linear_sizeof_expr(module_t *m, ast_expr_t expr, lir_opera
     return target;
 }
 
+/**
+ * 计算 atomic target 的地址，返回值总是存放了地址的 var
+ */
+static lir_operand_t *linear_atomic_addr(module_t *m, ast_expr_t expr) {
+    lir_operand_t *addr;
+    if (expr.assert_type == AST_EXPR_UNARY) {
+        // *p 直接使用 p 作为地址，不需要先加载到临时变量中
+        ast_unary_expr_t *unary_expr = expr.value;
+        assert(unary_expr->op == AST_OP_IA);
+        addr = linear_expr(m, unary_expr->operand, NULL);
+    } else {
+        lir_operand_t *operand = linear_expr(m, expr, NULL);
+        if (operand->assert_type == LIR_OPERAND_INDIRECT_ADDR && ((lir_indirect_addr_t *) operand->value)->offset == 0) {
+            addr = ((lir_indirect_addr_t *) operand->value)->base;
+        } else {
+            addr = lea_operand_pointer(m, operand);
+        }
+    }
+
+    if (addr->assert_type != LIR_OPERAND_VAR) {
+        lir_operand_t *temp = temp_var_operand(m, type_kind_new(TYPE_ANYPTR));
+        OP_PUSH(lir_op_move(temp, addr));
+        addr = temp;
+    }
+
+    return addr;
+}
+
+static lir_operand_t *linear_atomic_value(module_t *m, ast_expr_t *expr, type_t type) {
+    lir_operand_t *value = linear_expr(m, *expr, NULL);
+    if (value->assert_type == LIR_OPERAND_VAR) {
+        return value;
+    }
+
+    lir_operand_t *temp = temp_var_operand(m, type);
+    OP_PUSH(lir_op_move(temp, value));
+    return temp;
+}
+
+/**
+ * load/store 基于普通 move + fence 实现, add/swap/cas 编译为对应架构的原子指令(总是 full barrier)
+ */
+static lir_operand_t *linear_atomic_expr(module_t *m, ast_expr_t expr, lir_operand_t *target) {
+    ast_macro_atomic_expr_t *ast = expr.value;
+    type_t type = ast->target_type;
+
+    // 优先编译右值，避免 target 地址暴露后 vec grow 导致地址失效
+    lir_operand_t *expected = NULL;
+    if (ast->expected) {
+        expected = linear_atomic_value(m, ast->expected, type);
+    }
+
+    lir_operand_t *value = NULL;
+    if (ast->value) {
+        value = linear_atomic_value(m, ast->value, type);
+    }
+
+    lir_operand_t *addr = linear_atomic_addr(m, ast->target);
+    lir_operand_t *mem = indirect_addr_operand(m, type, addr, 0);
+
+    if (ast->op == ATOMIC_OP_LOAD) {
+        lir_operand_t *result = temp_var_operand(m, type);
+        OP_PUSH(lir_op_move(result, mem));
+        if (ast->order != ATOMIC_ORDER_RELAXED) {
+            OP_PUSH(lir_op_new(LIR_OPCODE_FENCE, integer_operand(LIR_FENCE_ACQUIRE, TYPE_UINT8), NULL, NULL));
+        }
+
+        return linear_super_move(m, expr.type, target, result);
+    }
+
+    if (is_gc_alloc(type.kind)) {
+        push_rt_call(m, RT_CALL_WRITE_BARRIER_SHADE, NULL, 2, addr, value);
+    }
+
+    if (ast->op == ATOMIC_OP_STORE) {
+        if (ast->order != ATOMIC_ORDER_RELAXED) {
+            OP_PUSH(lir_op_new(LIR_OPCODE_FENCE, integer_operand(LIR_FENCE_RELEASE, TYPE_UINT8), NULL, NULL));
+        }
+
+        OP_PUSH(lir_op_move(mem, value));
+
+        if (ast->order == ATOMIC_ORDER_SEQ_CST) {
+            OP_PUSH(lir_op_new(LIR_OPCODE_FENCE, integer_operand(LIR_FENCE_SEQ_CST, TYPE_UINT8), NULL, NULL));
+        }
+
+        return NULL;
+    }
+
+    lir_operand_t *old = temp_var_operand(m, type);
+    if (ast->op == ATOMIC_OP_CAS) {
+        slice_t *args = slice_new();
+        slice_push(args, expected);
+        slice_push(args, value);
+        OP_PUSH(lir_op_new(LIR_OPCODE_ATOMIC_CAS, mem, operand_new(LIR_OPERAND_ARGS, args), old));
+
+        if (!target) {
+            target = temp_var_operand_with_alloc(m, expr.type);
+        }
+
+        OP_PUSH(lir_op_new(LIR_OPCODE_SEE, old, expected, target));
+        return target;
+    }
+
+    lir_opcode_t code = ast->op == ATOMIC_OP_ADD ? LIR_OPCODE_ATOMIC_XADD : LIR_OPCODE_ATOMIC_XCHG;
+    OP_PUSH(lir_op_new(code, mem, value, old));
+
+    return linear_super_move(m, expr.type, target, old);
+}
+
 static lir_operand_t *linear_reflect_hash_expr(module_t *m, ast_expr_t expr, lir_operand_t *target) {
     ast_macro_sizeof_expr_t *ast = expr.value;
 
@@ -3478,6 +3610,7 @@ linear_expr_fn expr_fn_table[] = {
         [AST_MACRO_EXPR_DEFAULT] = linear_default_expr,
         [AST_MACRO_EXPR_SIZEOF] = linear_sizeof_expr,
         [AST_MACRO_EXPR_REFLECT_HASH] = linear_reflect_hash_expr,
+        [AST_MACRO_EXPR_ATOMIC] = linear_atomic_expr,
         [AST_EXPR_NEW] = linear_new_expr,
         [AST_CATCH] = linear_catch_expr,
         [AST_MATCH] = linear_match_expr,
@@ -62,6 +62,7 @@
 #define RT_CALL_UNSAFE_VEC_NEW "rt_unsafe_vec_new"
 
 #define RT_CALL_WRITE_BARRIER "write_barrier"
+#define RT_CALL_WRITE_BARRIER_SHADE "write_barrier_shade" // 仅进行着色, 赋值由 atomic 指令完成
 
 #define RT_CALL_RAWPTR_VALID "rawptr_valid"
 
@@ -143,6 +144,8 @@
 #define RT_CALL_SELECT_BLOCK "rt_select_block"
 
 #define RT_CALL_CHAN_SELECT "rt_chan_select"
+#define RT_CALL_CHAN_SELECT_TRY_SEND "rt_chan_select_try_send"
+#define RT_CALL_CHAN_SELECT_TRY_RECV "rt_chan_select_try_recv"
 
 #define RT_CALL_PROCESSOR_SET_EXIT "processor_set_exit"
 
@@ -231,6 +234,7 @@ static inline bool is_rtcall(string target) {
     return str_equal(target, RT_CALL_SET_ADD) || str_equal(target, RT_CALL_SET_DELETE) ||
            str_equal(target, RT_CALL_SET_CONTAINS) || str_equal(target, RT_CALL_SET_NEW) ||
            str_equal(target, RT_CALL_VEC_CAP) || str_equal(target, RT_CALL_WRITE_BARRIER) ||
+           str_equal(target, RT_CALL_WRITE_BARRIER_SHADE) ||
            str_equal(target, RT_CALL_RAWPTR_VALID) ||
            str_equal(target, RT_CALL_MAP_NEW) || str_equal(target, RT_CALL_MAP_ACCESS) ||
            str_equal(target, RT_CALL_MAP_ASSIGN) || str_equal(target, RT_CALL_MAP_LENGTH) ||
@@ -1143,6 +1147,12 @@ static inline bool lir_op_contain_cmp(lir_op_t *op) {
             op->code == LIR_OPCODE_USLT);
 }
 
+static inline bool lir_op_atomic(lir_op_t *op) {
+    return op->code == LIR_OPCODE_ATOMIC_XADD ||
+           op->code == LIR_OPCODE_ATOMIC_XCHG ||
+           op->code == LIR_OPCODE_ATOMIC_CAS;
+}
+
 static inline bool lir_op_term(lir_op_t *op) {
     return (op->code == LIR_OPCODE_ADD || op->code == LIR_OPCODE_SUB);
 }
@@ -292,6 +292,38 @@ static linked_t *amd64_lower_safepoint(closure_t *c, lir_op_t *op) {
     return list;
 }
 
+/**
+ * xadd/xchg [mem], value -> old 转换为二元形式 xadd [mem], temp -> temp
+ * cas 基于 cmpxchg 实现, expected 与 old value 都需要固定在 rax 中
+ */
+static linked_t *amd64_lower_atomic(closure_t *c, lir_op_t *op) {
+    linked_t *list = linked_new();
+    type_t type = lir_operand_type(op->output);
+
+    if (op->code == LIR_OPCODE_ATOMIC_CAS) {
+        slice_t *args = op->second->value;
+        assert(args->count == 2);
+
+        lir_operand_t *ax_operand = lir_reg_operand(rax->index, type.kind);
+        lir_operand_t *new_operand = temp_var_operand_with_alloc(c->module, type);
+        linked_push(list, lir_op_move(new_operand, args->take[1]));
+        linked_push(list, lir_op_move(ax_operand, args->take[0]));
+
+        slice_t *regs_args = slice_new();
+        slice_push(regs_args, ax_operand);
+        slice_push(regs_args, new_operand);
+        linked_push(list, lir_op_new(op->code, op->first, operand_new(LIR_OPERAND_ARGS, regs_args), ax_operand));
+        linked_push(list, lir_op_move(op->output, ax_operand));
+        return list;
+    }
+
+    lir_operand_t *temp = temp_var_operand_with_alloc(c->module, type);
+    linked_push(list, lir_op_move(temp, op->second));
+    linked_push(list, lir_op_new(op->code, op->first, temp, temp));
+    linked_push(list, lir_op_move(op->output, temp));
+    return list;
+}
+
 static void amd64_lower_block(closure_t *c, basic_block_t *block) {
     linked_t *operations = linked_new();
     LINKED_FOR(block->operations) {
@@ -340,6 +372,11 @@ static void amd64_lower_block(closure_t *c, basic_block_t *block) {
             continue;
         }
 
+        if (lir_op_atomic(op)) {
+            linked_concat(operations, amd64_lower_atomic(c, op));
+            continue;
+        }
+
         // lea symbol_label -> var 等都是允许的，主要是应对 imm int
         if (op->code == LIR_OPCODE_LEA && op->first->assert_type == LIR_OPERAND_IMM) {
             op->first = amd64_convert_first_to_temp(c, operations, op->first);
@@ -218,6 +218,33 @@ static linked_t *arm64_lower_safepoint(closure_t *c, lir_op_t *op) {
     return list;
 }
 
+/**
+ * 原子指令在 native 中可能展开为 ldaxr/stlxr 循环, old 值所在的寄存器不能与 addr/value 重叠,
+ * 因此将 temp 同时作为输入(ARGS 末尾)与输出, 使其与其他操作数同时活跃
+ * cas: ARGS[expected, new] -> ARGS[expected, new, old], xadd/xchg: value -> ARGS[value, old]
+ */
+static linked_t *arm64_lower_atomic(closure_t *c, lir_op_t *op) {
+    linked_t *list = linked_new();
+    slice_t *new_args = slice_new();
+    if (op->code == LIR_OPCODE_ATOMIC_CAS) {
+        slice_t *args = op->second->value;
+        assert(args->count == 2);
+        slice_push(new_args, args->take[0]);
+        slice_push(new_args, args->take[1]);
+    } else {
+        slice_push(new_args, op->second);
+    }
+
+    lir_operand_t *temp = temp_var_operand_with_alloc(c->module, lir_operand_type(op->output));
+    linked_push(list, lir_op_move(temp, new_args->take[0]));
+    slice_push(new_args, lir_reset_operand(temp, LIR_FLAG_SECOND));
+
+    linked_push(list, lir_op_new(op->code, op->first, operand_new(LIR_OPERAND_ARGS, new_args), temp));
+    linked_push(list, lir_op_move(op->output, temp));
+
+    return list;
+}
+
 /**
  * lea sym -> [t]
  * -->
@@ -296,6 +323,11 @@ static void arm64_lower_block(closure_t *c, basic_block_t *block) {
             continue;
         }
 
+        if (lir_op_atomic(op)) {
+            linked_concat(operations, arm64_lower_atomic(c, op));
+            continue;
+        }
+
         if (lir_op_ternary(op) || op->code == LIR_OPCODE_NOT || op->code == LIR_OPCODE_NEG || lir_op_convert(op)) {
             linked_concat(operations, arm64_lower_ternary(c, op));
             continue;
@@ -221,6 +221,28 @@ static linked_t *riscv64_lower_safepoint(closure_t *c, lir_op_t *op) {
     return list;
 }
 
+/**
+ * cas 在 native 中展开为 lr/sc 循环, old 值所在的寄存器不能与 addr/expected/new 重叠,
+ * 因此将 temp 同时作为输入(ARGS)与输出, 使其与其他操作数同时活跃
+ */
+static linked_t *riscv64_lower_atomic_cas(closure_t *c, lir_op_t *op) {
+    linked_t *list = linked_new();
+    slice_t *args = op->second->value;
+    assert(args->count == 2);
+
+    lir_operand_t *temp = temp_var_operand_with_alloc(c->module, lir_operand_type(op->output));
+    linked_push(list, lir_op_move(temp, args->take[0]));
+
+    slice_t *new_args = slice_new();
+    slice_push(new_args, args->take[0]);
+    slice_push(new_args, args->take[1]);
+    slice_push(new_args, lir_reset_operand(temp, LIR_FLAG_SECOND));
+    linked_push(list, lir_op_new(op->code, op->first, operand_new(LIR_OPERAND_ARGS, new_args), temp));
+    linked_push(list, lir_op_move(op->output, temp));
+
+    return list;
+}
+
 /**
  * 处理加载有效地址指令
  * RISC-V使用la伪指令（auipc+addi）或者lui+addi实现
@@ -291,6 +313,11 @@ static void riscv64_lower_block(closure_t *c, basic_block_t *block) {
             continue;
         }
 
+        if (op->code == LIR_OPCODE_ATOMIC_CAS) {
+            linked_concat(operations, riscv64_lower_atomic_cas(c, op));
+            continue;
+        }
+
         if (op->code == LIR_OPCODE_LEA) {
             linked_concat(operations, riscv64_lower_lea(c, op));
             continue;
@@ -1062,6 +1062,46 @@ static slice_t *amd64_native_safepoint(closure_t *c, lir_op_t *op) {
     return operations;
 }
 
+/**
+ * lower 阶段已经转换为二元形式, xadd/xchg 的 second 与 output 为同一个寄存器
+ * cas 的 expected 与 output 已经固定在 rax 中
+ */
+static slice_t *amd64_native_atomic(closure_t *c, lir_op_t *op) {
+    slice_t *operations = slice_new();
+    amd64_asm_operand_t *mem = lir_operand_trans_amd64(c, op, op->first);
+
+    if (op->code == LIR_OPCODE_ATOMIC_CAS) {
+        slice_t *args = op->second->value;
+        amd64_asm_operand_t *new_value = lir_operand_trans_amd64(c, op, args->take[1]);
+        slice_push(operations, AMD64_INST("cmpxchg", mem, new_value));
+        return operations;
+    }
+
+    amd64_asm_operand_t *value = lir_operand_trans_amd64(c, op, op->second);
+    amd64_asm_operand_t *output = lir_operand_trans_amd64(c, op, op->output);
+    assert(asm_operand_equal(value, output));
+
+    if (op->code == LIR_OPCODE_ATOMIC_XADD) {
+        slice_push(operations, AMD64_INST("xadd", mem, value));
+    } else {
+        slice_push(operations, AMD64_INST("xchg", mem, value));
+    }
+
+    return operations;
+}
+
+/**
+ * amd64 是 TSO 内存模型, load acquire 与 store release 天然满足，只有 seq_cst 需要 mfence
+ */
+static slice_t *amd64_native_fence(closure_t *c, lir_op_t *op) {
+    slice_t *operations = slice_new();
+    lir_imm_t *imm = op->first->value;
+    if (imm->int_value == LIR_FENCE_SEQ_CST) {
+        slice_push(operations, AMD64_INST("mfence"));
+    }
+
+    return operations;
+}
 
 amd64_native_fn amd64_native_table[] = {
         [LIR_OPCODE_CLR] = amd64_native_clr,
@@ -1089,6 +1129,12 @@ amd64_native_fn amd64_native_table[] = {
 
         [LIR_OPCODE_SAFEPOINT] = amd64_native_safepoint,
 
+        // 原子操作
+        [LIR_OPCODE_ATOMIC_XADD] = amd64_native_atomic,
+        [LIR_OPCODE_ATOMIC_XCHG] = amd64_native_atomic,
+        [LIR_OPCODE_ATOMIC_CAS] = amd64_native_atomic,
+        [LIR_OPCODE_FENCE] = amd64_native_fence,
+
         // 一元运算符
         [LIR_OPCODE_NEG] = amd64_native_neg,
 
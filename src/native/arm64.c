@@ -1151,6 +1151,107 @@ static slice_t *arm64_native_safepoint(closure_t *c, lir_op_t *op) {
     return operations;
 }
 
+#define ARM64_DMB_ISHLD 0x9
+#define ARM64_DMB_ISH 0xb
+
+/**
+ * 默认展开为 ldaxr/stlxr 循环(ARMv8.0 即可用)并在结尾追加 dmb ish, --arm64-lse 时使用 LSE 原子指令(AL 后缀),
+ * 两者都是 full barrier, 满足所有 ordering
+ * first 为 [addr+0], cas 的 second 为 ARGS[expected, new, old], 其余 second 为 ARGS[value, old]
+ * old 即 output, lower 阶段保证其寄存器与 addr/value 不重叠, 循环中仅额外借助 x16
+ */
+static slice_t *arm64_native_atomic(closure_t *c, lir_op_t *op) {
+    slice_t *operations = slice_new();
+    arm64_asm_operand_t *mem = lir_operand_trans_arm64(c, op, op->first, operations);
+    arm64_asm_operand_t *result = lir_operand_trans_arm64(c, op, op->output, operations);
+    assert(mem->type == ARM64_ASM_OPERAND_INDIRECT && mem->indirect.offset == 0);
+    assert(result->type == ARM64_ASM_OPERAND_REG);
+
+    slice_t *args = op->second->value;
+    arm64_asm_operand_t *value = lir_operand_trans_arm64(c, op, args->take[0], operations);
+    assert(value->type == ARM64_ASM_OPERAND_REG);
+
+    if (op->code == LIR_OPCODE_ATOMIC_CAS) {
+        assert(args->count == 3);
+        arm64_asm_operand_t *new_value = lir_operand_trans_arm64(c, op, args->take[1], operations);
+
+        if (BUILD_ARM64_LSE) {
+            // casal 会将 [addr] 的旧值写回 rs
+            slice_push(operations, ARM64_INST(R_MOV, result, value));
+            slice_push(operations, ARM64_INST(R_CASAL, result, new_value, mem));
+            return operations;
+        }
+
+        // retry:
+        //   ldaxr result, [addr]
+        //   cmp result, expected
+        //   b.ne done
+        //   stlxr w16, new, [addr]
+        //   cmp w16, #0
+        //   b.ne retry
+        // done:
+        //   dmb ish
+        slice_push(operations, ARM64_INST(R_LDAXR, result, mem));
+        slice_push(operations, ARM64_INST(R_CMP, result, value));
+        slice_push(operations, ARM64_INST(R_BNE, ARM64_IMM(16)));
+        slice_push(operations, ARM64_INST(R_STLXR, ARM64_REG(w16), new_value, mem));
+        slice_push(operations, ARM64_INST(R_CMP, ARM64_REG(w16), ARM64_IMM(0)));
+        slice_push(operations, ARM64_INST(R_BNE, ARM64_IMM(-20)));
+        slice_push(operations, ARM64_INST(R_DMB, ARM64_IMM(ARM64_DMB_ISH)));
+        return operations;
+    }
+
+    assert(args->count == 2);
+    if (BUILD_ARM64_LSE) {
+        arm64_asm_raw_opcode_t raw = op->code == LIR_OPCODE_ATOMIC_XADD ? R_LDADDAL : R_SWPAL;
+        slice_push(operations, ARM64_INST(raw, value, result, mem));
+        return operations;
+    }
+
+    if (op->code == LIR_OPCODE_ATOMIC_XADD) {
+        // stlxr 的状态寄存器不能与数据寄存器相同, 因此 result 暂存 new, 循环结束后再减去 value 还原 old
+        // retry:
+        //   ldaxr x16, [addr]
+        //   add result, x16, value
+        //   stlxr w16, result, [addr]
+        //   cmp w16, #0
+        //   b.ne retry
+        //   sub result, result, value
+        slice_push(operations, ARM64_INST(R_LDAXR, ARM64_REG(x16), mem));
+        slice_push(operations, ARM64_INST(R_ADD, result, ARM64_REG(x16), value));
+        slice_push(operations, ARM64_INST(R_STLXR, ARM64_REG(w16), result, mem));
+        slice_push(operations, ARM64_INST(R_CMP, ARM64_REG(w16), ARM64_IMM(0)));
+        slice_push(operations, ARM64_INST(R_BNE, ARM64_IMM(-16)));
+        slice_push(operations, ARM64_INST(R_SUB, result, result, value));
+    } else {
+        // retry:
+        //   ldaxr result, [addr]
+        //   stlxr w16, value, [addr]
+        //   cmp w16, #0
+        //   b.ne retry
+        slice_push(operations, ARM64_INST(R_LDAXR, result, mem));
+        slice_push(operations, ARM64_INST(R_STLXR, ARM64_REG(w16), value, mem));
+        slice_push(operations, ARM64_INST(R_CMP, ARM64_REG(w16), ARM64_IMM(0)));
+        slice_push(operations, ARM64_INST(R_BNE, ARM64_IMM(-12)));
+    }
+    slice_push(operations, ARM64_INST(R_DMB, ARM64_IMM(ARM64_DMB_ISH)));
+
+    return operations;
+}
+
+static slice_t *arm64_native_fence(closure_t *c, lir_op_t *op) {
+    slice_t *operations = slice_new();
+    lir_imm_t *imm = op->first->value;
+
+    // acquire 仅需约束后续访存不越过之前的 load
+    if (imm->int_value == LIR_FENCE_ACQUIRE) {
+        slice_push(operations, ARM64_INST(R_DMB, ARM64_IMM(ARM64_DMB_ISHLD)));
+    } else {
+        slice_push(operations, ARM64_INST(R_DMB, ARM64_IMM(ARM64_DMB_ISH)));
+    }
+
+    return operations;
+}
 
 arm64_native_fn arm64_native_table[] = {
         [LIR_OPCODE_CLR] = arm64_native_clr,
@@ -1211,6 +1312,11 @@ arm64_native_fn arm64_native_table[] = {
         [LIR_OPCODE_FN_END] = arm64_native_fn_end,
 
         [LIR_OPCODE_SAFEPOINT] = arm64_native_safepoint,
+
+        [LIR_OPCODE_ATOMIC_XADD] = arm64_native_atomic,
+        [LIR_OPCODE_ATOMIC_XCHG] = arm64_native_atomic,
+        [LIR_OPCODE_ATOMIC_CAS] = arm64_native_atomic,
+        [LIR_OPCODE_FENCE] = arm64_native_fence,
 };
 
 
@@ -1328,6 +1328,61 @@ static slice_t *riscv64_native_safepoint(closure_t *c, lir_op_t *op) {
     return operations;
 }
 
+/**
+ * 原子读改写统一使用 aq+rl 形式, 满足所有 ordering
+ * first 为 [addr+0], cas 的 second 为 ARGS[expected, new, old], 其余 second 为 value
+ */
+static slice_t *riscv64_native_atomic(closure_t *c, lir_op_t *op) {
+    slice_t *operations = slice_new();
+    riscv64_asm_operand_t *mem = lir_operand_trans_riscv64(c, op, op->first, operations);
+    riscv64_asm_operand_t *result = lir_operand_trans_riscv64(c, op, op->output, operations);
+    assert(mem->type == RISCV64_ASM_OPERAND_INDIRECT && mem->indirect.offset == 0);
+    assert(result->type == RISCV64_ASM_OPERAND_REG);
+
+    if (op->code == LIR_OPCODE_ATOMIC_CAS) {
+        slice_t *args = op->second->value;
+        assert(args->count == 3);
+        riscv64_asm_operand_t *expected = lir_operand_trans_riscv64(c, op, args->take[0], operations);
+        riscv64_asm_operand_t *new_value = lir_operand_trans_riscv64(c, op, args->take[1], operations);
+
+        // retry:
+        //   lr.d.aqrl result, (addr)
+        //   bne result, expected, done
+        //   sc.d.aqrl t6, new, (addr)
+        //   bnez t6, retry
+        // done:
+        slice_push(operations, RISCV64_INST(RV_LR_D, result, mem));
+        slice_push(operations, RISCV64_INST(RV_BNE, result, expected, RO_IMM(12)));
+        slice_push(operations, RISCV64_INST(RV_SC_D, RO_REG(T6), new_value, mem));
+        slice_push(operations, RISCV64_INST(RV_BNE, RO_REG(T6), RO_REG(ZEROREG), RO_IMM(-12)));
+        return operations;
+    }
+
+    riscv64_asm_operand_t *value = lir_operand_trans_riscv64(c, op, op->second, operations);
+    assert(value->type == RISCV64_ASM_OPERAND_REG);
+    riscv64_asm_raw_opcode_t raw = op->code == LIR_OPCODE_ATOMIC_XADD ? RV_AMOADD_D : RV_AMOSWAP_D;
+    slice_push(operations, RISCV64_INST(raw, result, value, mem));
+
+    return operations;
+}
+
+#define RV_FENCE_R 0x2
+#define RV_FENCE_W 0x1
+
+static slice_t *riscv64_native_fence(closure_t *c, lir_op_t *op) {
+    slice_t *operations = slice_new();
+    lir_imm_t *imm = op->first->value;
+
+    if (imm->int_value == LIR_FENCE_ACQUIRE) {
+        slice_push(operations, RISCV64_INST(RV_FENCE, RO_IMM(RV_FENCE_R), RO_IMM(RV_FENCE_R | RV_FENCE_W)));
+    } else if (imm->int_value == LIR_FENCE_RELEASE) {
+        slice_push(operations, RISCV64_INST(RV_FENCE, RO_IMM(RV_FENCE_R | RV_FENCE_W), RO_IMM(RV_FENCE_W)));
+    } else {
+        slice_push(operations, RISCV64_INST(RV_FENCE, RO_IMM(RV_FENCE_R | RV_FENCE_W), RO_IMM(RV_FENCE_R | RV_FENCE_W)));
+    }
+
+    return operations;
+}
 
 static slice_t *riscv64_native_push(closure_t *c, lir_op_t *op) {
     slice_t *operations = slice_new();
@@ -1411,6 +1466,11 @@ static riscv64_native_fn riscv64_native_table[] = {
         [LIR_OPCODE_FN_END] = riscv64_native_fn_end,
 
         [LIR_OPCODE_SAFEPOINT] = riscv64_native_safepoint,
+
+        [LIR_OPCODE_ATOMIC_XADD] = riscv64_native_atomic,
+        [LIR_OPCODE_ATOMIC_XCHG] = riscv64_native_atomic,
+        [LIR_OPCODE_ATOMIC_CAS] = riscv64_native_atomic,
+        [LIR_OPCODE_FENCE] = riscv64_native_fence,
 };
 
 /**
@@ -99,6 +99,11 @@ static alloc_kind_e alloc_kind_of_use(closure_t *c, lir_op_t *op, lir_var_t *var
         return ALLOC_KIND_MUST;
     }
 
+    // 原子指令的 value/expected/new 都必须是寄存器
+    if (lir_op_atomic(op)) {
+        return ALLOC_KIND_MUST;
+    }
+
     // lea 指令的 use 一定是 first, 所以不需要重复判断
     if (op->code == LIR_OPCODE_LEA) {
         return ALLOC_KIND_NOT;
@@ -253,7 +253,7 @@ static inline rtype_t rtype_chan(type_t t) {
     rtype_t rtype = {
             .size = sizeof(n_chan_t),
             .hash = type_hash(t),
-            .last_ptr = POINTER_SIZE * 5,
+            .last_ptr = POINTER_SIZE * 6,
             .kind = TYPE_CHAN,
             .length = 1,
             .hashes_offset = data_put(NULL, sizeof(int64_t)),
@@ -268,6 +268,7 @@ static inline rtype_t rtype_chan(type_t t) {
     bitmap_set(CTDATA(rtype.malloc_gc_bits_offset), 2);
     bitmap_set(CTDATA(rtype.malloc_gc_bits_offset), 3);
     bitmap_set(CTDATA(rtype.malloc_gc_bits_offset), 4);
+    bitmap_set(CTDATA(rtype.malloc_gc_bits_offset), 5);
 
     ((int64_t *) CTDATA(rtype.hashes_offset))[0] = type_hash(t.chan->element_type);
 
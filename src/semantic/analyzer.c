@@ -1021,6 +1021,16 @@ static void analyzer_type_eq_expr(module_t *m, ast_macro_type_eq_expr_t *expr) {
     analyzer_type(m, &expr->right_type);
 }
 
+static void analyzer_atomic_expr(module_t *m, ast_macro_atomic_expr_t *atomic_expr) {
+    analyzer_expr(m, &atomic_expr->target);
+    if (atomic_expr->expected) {
+        analyzer_expr(m, atomic_expr->expected);
+    }
+    if (atomic_expr->value) {
+        analyzer_expr(m, atomic_expr->value);
+    }
+}
+
 static void analyzer_is_expr(module_t *m, ast_is_expr_t *is_expr) {
     analyzer_type(m, &is_expr->target_type);
     analyzer_expr(m, &is_expr->src);
@@ -1853,6 +1863,9 @@ static void analyzer_expr(module_t *m, ast_expr_t *expr) {
         case AST_MACRO_EXPR_TYPE_EQ: {
             return analyzer_type_eq_expr(m, expr->value);
         }
+        case AST_MACRO_EXPR_ATOMIC: {
+            return analyzer_atomic_expr(m, expr->value);
+        }
         case AST_EXPR_NEW: {
             return analyzer_new_expr(m, expr->value);
         }
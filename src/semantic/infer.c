@@ -1481,6 +1481,76 @@ static type_t infer_type_eq_expr(module_t *m, ast_expr_t *expr) {
     return type_kind_new(TYPE_BOOL);
 }
 
+/**
+ * @atomic_xxx(target, ...) target 必须是可寻址的 8byte 整数或者指针
+ */
+static type_t infer_atomic_expr(module_t *m, ast_macro_atomic_expr_t *atomic_expr) {
+    ast_expr_t *target = &atomic_expr->target;
+    type_t target_type = infer_left_expr(m, target);
+
+    bool addressable = target->assert_type == AST_EXPR_IDENT ||
+                       target->assert_type == AST_EXPR_STRUCT_SELECT ||
+                       target->assert_type == AST_EXPR_VEC_ACCESS ||
+                       target->assert_type == AST_EXPR_ARRAY_ACCESS ||
+                       target->assert_type == AST_EXPR_ENV_ACCESS ||
+                       (target->assert_type == AST_EXPR_UNARY && ((ast_unary_expr_t *) target->value)->op == AST_OP_IA);
+    INFER_ASSERTF(addressable, "atomic target must be a var, struct field, vec or array element");
+
+    bool is_ptr = target_type.kind == TYPE_PTR || target_type.kind == TYPE_RAWPTR || target_type.kind == TYPE_ANYPTR;
+    INFER_ASSERTF((is_integer(target_type.kind) || is_ptr) && type_kind_sizeof(target_type.kind) == POINTER_SIZE,
+                  "atomic target must be int/i64/u64/uint or pointer, actual '%s'", type_format(target_type));
+
+    if (atomic_expr->op == ATOMIC_OP_ADD) {
+        INFER_ASSERTF(is_integer(target_type.kind), "@atomic_add target must be integer, actual '%s'",
+                      type_format(target_type));
+    }
+
+    if (atomic_expr->op == ATOMIC_OP_LOAD) {
+        INFER_ASSERTF(atomic_expr->order != ATOMIC_ORDER_RELEASE && atomic_expr->order != ATOMIC_ORDER_ACQ_REL,
+                      "@atomic_load cannot use release ordering");
+    }
+
+    if (atomic_expr->op == ATOMIC_OP_STORE) {
+        INFER_ASSERTF(atomic_expr->order != ATOMIC_ORDER_ACQUIRE && atomic_expr->order != ATOMIC_ORDER_ACQ_REL,
+                      "@atomic_store cannot use acquire ordering");
+    }
+
+    // env 中仅 scala 类型以堆指针的形式共享, 其余类型是值拷贝
+    if (target->assert_type == AST_EXPR_ENV_ACCESS) {
+        INFER_ASSERTF(is_scala_type(target_type), "atomic target captured by closure must be integer");
+    }
+
+    // 指针类型的局部变量无法逃逸到堆中, 其他 coroutine 也无法观测到
+    if (target->assert_type == AST_EXPR_IDENT && !is_stack_alloc_type(target_type)) {
+        ast_ident *ident = target->value;
+        symbol_t *s = symbol_table_get(ident->literal);
+        INFER_ASSERTF(!s->is_local, "atomic pointer target cannot be a local var, use struct field or global var");
+    }
+
+    // 栈上的局部变量无法被其他 coroutine 观测到，需要逃逸到堆中
+    marking_heap_alloc(target);
+
+    if (atomic_expr->expected) {
+        infer_right_expr(m, atomic_expr->expected, target_type);
+    }
+
+    if (atomic_expr->value) {
+        infer_right_expr(m, atomic_expr->value, target_type);
+    }
+
+    atomic_expr->target_type = target_type;
+
+    if (atomic_expr->op == ATOMIC_OP_STORE) {
+        return type_kind_new(TYPE_VOID);
+    }
+
+    if (atomic_expr->op == ATOMIC_OP_CAS) {
+        return type_kind_new(TYPE_BOOL);
+    }
+
+    return target_type;
+}
+
 /**
  * unary
  * @param expr
@@ -3018,6 +3088,9 @@ static type_t infer_expr(module_t *m, ast_expr_t *expr, type_t target_type, type
         case AST_MACRO_EXPR_TYPE_EQ: {
             return infer_type_eq_expr(m, expr);
         }
+        case AST_MACRO_EXPR_ATOMIC: {
+            return infer_atomic_expr(m, expr->value);
+        }
         case AST_EXPR_NEW: {
             return infer_new_expr(m, expr->value);
         }
@@ -33,6 +33,11 @@
 #define MACRO_ULA "ula"
 #define MACRO_SLA "sla"
 #define MACRO_DEFAULT "default"
+#define MACRO_ATOMIC_LOAD "atomic_load"
+#define MACRO_ATOMIC_STORE "atomic_store"
+#define MACRO_ATOMIC_ADD "atomic_add"
+#define MACRO_ATOMIC_SWAP "atomic_swap"
+#define MACRO_ATOMIC_CAS "atomic_cas"
 
 /**
  * 编译时产生的所有符号都进行唯一处理后写入到该 table 中
@@ -3324,6 +3324,67 @@ static ast_expr_t parser_macro_sla_expr(module_t *m) {
 }
 
 
+static atomic_order_t parser_atomic_order(module_t *m) {
+    token_t *token = parser_must(m, TOKEN_IDENT);
+    if (str_equal(token->literal, "relaxed")) {
+        return ATOMIC_ORDER_RELAXED;
+    }
+    if (str_equal(token->literal, "acquire")) {
+        return ATOMIC_ORDER_ACQUIRE;
+    }
+    if (str_equal(token->literal, "release")) {
+        return ATOMIC_ORDER_RELEASE;
+    }
+    if (str_equal(token->literal, "acq_rel")) {
+        return ATOMIC_ORDER_ACQ_REL;
+    }
+    if (str_equal(token->literal, "seq_cst")) {
+        return ATOMIC_ORDER_SEQ_CST;
+    }
+
+    PARSER_ASSERTF(false, "unknown atomic ordering '%s'", token->literal);
+}
+
+/**
+ * @atomic_load(target[, order])
+ * @atomic_store(target, value[, order])
+ * @atomic_add(target, delta[, order])
+ * @atomic_swap(target, value[, order])
+ * @atomic_cas(target, expected, new[, order])
+ */
+static ast_expr_t parser_macro_atomic_expr(module_t *m, atomic_op_t op) {
+    ast_expr_t result = expr_new(m);
+    ast_macro_atomic_expr_t *atomic_expr = NEW(ast_macro_atomic_expr_t);
+    atomic_expr->op = op;
+    atomic_expr->order = ATOMIC_ORDER_SEQ_CST;
+
+    parser_must(m, TOKEN_LEFT_PAREN);
+    atomic_expr->target = parser_expr(m);
+
+    if (op == ATOMIC_OP_CAS) {
+        parser_must(m, TOKEN_COMMA);
+        atomic_expr->expected = NEW(ast_expr_t);
+        *atomic_expr->expected = parser_expr(m);
+    }
+
+    if (op != ATOMIC_OP_LOAD) {
+        parser_must(m, TOKEN_COMMA);
+        atomic_expr->value = NEW(ast_expr_t);
+        *atomic_expr->value = parser_expr(m);
+    }
+
+    // 可选的 memory order, 默认 seq_cst
+    if (parser_consume(m, TOKEN_COMMA)) {
+        atomic_expr->order = parser_atomic_order(m);
+    }
+    parser_must(m, TOKEN_RIGHT_PAREN);
+
+    result.assert_type = AST_MACRO_EXPR_ATOMIC;
+    result.value = atomic_expr;
+    return result;
+}
+
+
 /**
 * 宏就解析成对应的 expr 好了，然后正常走 analyzer/infer/linear
 * @param m
@@ -3357,6 +3418,26 @@ static ast_expr_t parser_macro_call(module_t *m) {
         return parser_macro_sla_expr(m);
     }
 
+    if (str_equal(token->literal, MACRO_ATOMIC_LOAD)) {
+        return parser_macro_atomic_expr(m, ATOMIC_OP_LOAD);
+    }
+
+    if (str_equal(token->literal, MACRO_ATOMIC_STORE)) {
+        return parser_macro_atomic_expr(m, ATOMIC_OP_STORE);
+    }
+
+    if (str_equal(token->literal, MACRO_ATOMIC_ADD)) {
+        return parser_macro_atomic_expr(m, ATOMIC_OP_ADD);
+    }
+
+    if (str_equal(token->literal, MACRO_ATOMIC_SWAP)) {
+        return parser_macro_atomic_expr(m, ATOMIC_OP_SWAP);
+    }
+
+    if (str_equal(token->literal, MACRO_ATOMIC_CAS)) {
+        return parser_macro_atomic_expr(m, ATOMIC_OP_CAS);
+    }
+
     PARSER_ASSERTF(false, "macro '%s' not defined", token->literal);
 }
 
@@ -443,9 +443,21 @@ typedef enum {
 
     LIR_OPCODE_SAFEPOINT,
 
+    // 原子操作, first 为 indirect addr, 总是以 full barrier 语义执行
+    LIR_OPCODE_ATOMIC_XADD, // xadd [first], second -> output(old)
+    LIR_OPCODE_ATOMIC_XCHG, // xchg [first], second -> output(old)
+    LIR_OPCODE_ATOMIC_CAS, // cas [first], args(expected, new) -> output(old)
+    LIR_OPCODE_FENCE, // first 为 imm(lir_fence_kind_t)
+
     LIR_OPCODE_NOP, // 空的，不做任何操作的指令，但是将用于 ssa 的完整 use-def
 } lir_opcode_t;
 
+typedef enum {
+    LIR_FENCE_ACQUIRE = 1, // load 之后, 阻止后续读写重排到 load 之前
+    LIR_FENCE_RELEASE, // store 之前, 阻止之前的读写重排到 store 之后
+    LIR_FENCE_SEQ_CST, // full barrier
+} lir_fence_kind_t;
+
 typedef struct lir_operand_t lir_operand_t;
 
 /**
@@ -0,0 +1,7 @@
+#include "tests/test.h"
+
+int main(void) {
+    // 通过环境变量指定 processor 数量
+    setenv("NATURE_PROCS", "3", 1);
+    feature_testar_test(NULL);
+}
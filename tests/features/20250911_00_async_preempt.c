@@ -0,0 +1,7 @@
+#include "tests/test.h"
+
+int main(void) {
+    // 单个 processor 时没有 safepoint 的循环只能通过异步抢占让出
+    setenv("NATURE_PROCS", "1", 1);
+    feature_testar_test(NULL);
+}
@@ -0,0 +1,8 @@
+#include "tests/test.h"
+
+int main(void) {
+    setenv("NATURE_PROCS", "2", 1);
+    setenv("NATURE_SCHED_SLICE", "2", 1);
+    setenv("NATURE_SCHED_BATCH", "8", 1);
+    feature_testar_test(NULL);
+}
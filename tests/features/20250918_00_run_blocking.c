@@ -0,0 +1,7 @@
+#include "tests/test.h"
+
+int main(void) {
+    setenv("NATURE_PROCS", "2", 1);
+    setenv("NATURE_BLOCKING_MAX", "4", 1);
+    feature_testar_test(NULL);
+}
@@ -0,0 +1,7 @@
+#include "tests/test.h"
+
+int main(void) {
+    setenv("NATURE_PROCS", "4", 1);
+    setenv("NATURE_AFFINITY", "1", 1);
+    feature_testar_test(NULL);
+}
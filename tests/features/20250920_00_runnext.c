@@ -0,0 +1,6 @@
+#include "tests/test.h"
+
+int main(void) {
+    setenv("NATURE_PROCS", "1", 1);
+    feature_testar_test(NULL);
+}
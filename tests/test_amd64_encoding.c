@@ -138,6 +138,24 @@ static void test_basic() {
 
     inst = AMD64_INST("cvtsd2ss", AMD64_REG(xmm1s32), AMD64_REG(xmm2s64));
     TEST_EQ(*inst, 0xF2, 0x0F, 0x5A, 0xCA);
+
+    // lock xadd QWORD PTR [rdx], rax
+    inst = AMD64_INST("xadd", INDIRECT_REG(rdx, QWORD), AMD64_REG(rax));
+    TEST_EQ(*inst, 0xF0, 0x48, 0x0F, 0xC1, 0x02);
+
+    // lock xadd QWORD PTR [r10+0x10], r11
+    inst = AMD64_INST("xadd", DISP_REG(r10, 16, QWORD), AMD64_REG(r11));
+    TEST_EQ(*inst, 0xF0, 0x4D, 0x0F, 0xC1, 0x5A, 0x10);
+
+    inst = AMD64_INST("xchg", INDIRECT_REG(rdx, QWORD), AMD64_REG(rax));
+    TEST_EQ(*inst, 0x48, 0x87, 0x02);
+
+    // lock cmpxchg QWORD PTR [rdx], rcx
+    inst = AMD64_INST("cmpxchg", INDIRECT_REG(rdx, QWORD), AMD64_REG(rcx));
+    TEST_EQ(*inst, 0xF0, 0x48, 0x0F, 0xB1, 0x0A);
+
+    inst = AMD64_INST("mfence");
+    TEST_EQ(*inst, 0x0F, 0xAE, 0xF0);
 }
 
 
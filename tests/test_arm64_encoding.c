@@ -157,6 +157,33 @@ static void test_basic() {
     // 测试 fmov s1, wzr
     inst = ARM64_INST(R_FMOV, ARM64_REG(s1), ARM64_REG(wzr)); // 0110251E
     TEST_EQ(inst, 0xE1, 0x03, 0x27, 0x1E);
+
+    // ldaddal x1, x0, [x2]
+    inst = ARM64_INST(R_LDADDAL, ARM64_REG(x1), ARM64_REG(x0), ARM64_INDIRECT(x2, 0, 0, 8));
+    TEST_EQ(inst, 0x40, 0x00, 0xe1, 0xf8);
+
+    // swpal x1, x0, [x2]
+    inst = ARM64_INST(R_SWPAL, ARM64_REG(x1), ARM64_REG(x0), ARM64_INDIRECT(x2, 0, 0, 8));
+    TEST_EQ(inst, 0x40, 0x80, 0xe1, 0xf8);
+
+    // casal x16, x1, [x2]
+    inst = ARM64_INST(R_CASAL, ARM64_REG(x16), ARM64_REG(x1), ARM64_INDIRECT(x2, 0, 0, 8));
+    TEST_EQ(inst, 0x41, 0xfc, 0xf0, 0xc8);
+
+    // dmb ish / dmb ishld
+    inst = ARM64_INST(R_DMB, ARM64_IMM(0xb));
+    TEST_EQ(inst, 0xbf, 0x3b, 0x03, 0xd5);
+
+    inst = ARM64_INST(R_DMB, ARM64_IMM(0x9));
+    TEST_EQ(inst, 0xbf, 0x39, 0x03, 0xd5);
+
+    // ldaxr x0, [x2]
+    inst = ARM64_INST(R_LDAXR, ARM64_REG(x0), ARM64_INDIRECT(x2, 0, 0, 8));
+    TEST_EQ(inst, 0x40, 0xfc, 0x5f, 0xc8);
+
+    // stlxr w16, x1, [x2]
+    inst = ARM64_INST(R_STLXR, ARM64_REG(w16), ARM64_REG(x1), ARM64_INDIRECT(x2, 0, 0, 8));
+    TEST_EQ(inst, 0x41, 0xfc, 0x10, 0xc8);
 }
 
 
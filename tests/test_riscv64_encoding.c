@@ -131,6 +131,28 @@ static void test_basic() {
 
     inst = RISCV64_INST(RV_J, RO_IMM(-4096));
     TEST_EQ(inst, 0x6f, 0xf0, 0x0f, 0x80);
+
+    inst = RISCV64_INST(RV_AMOADD_D, RO_REG(T0), RO_REG(T1), RO_INDIRECT(T2, 0, QWORD));
+    TEST_EQ(inst, 0xaf, 0xb2, 0x63, 0x06);
+
+    inst = RISCV64_INST(RV_AMOSWAP_D, RO_REG(T0), RO_REG(T1), RO_INDIRECT(T2, 0, QWORD));
+    TEST_EQ(inst, 0xaf, 0xb2, 0x63, 0x0e);
+
+    inst = RISCV64_INST(RV_LR_D, RO_REG(T0), RO_INDIRECT(T2, 0, QWORD));
+    TEST_EQ(inst, 0xaf, 0xb2, 0x03, 0x16);
+
+    inst = RISCV64_INST(RV_SC_D, RO_REG(T6), RO_REG(T1), RO_INDIRECT(T2, 0, QWORD));
+    TEST_EQ(inst, 0xaf, 0xbf, 0x63, 0x1e);
+
+    // fence rw,rw / fence r,rw / fence rw,w
+    inst = RISCV64_INST(RV_FENCE, RO_IMM(0x3), RO_IMM(0x3));
+    TEST_EQ(inst, 0x0f, 0x00, 0x30, 0x03);
+
+    inst = RISCV64_INST(RV_FENCE, RO_IMM(0x2), RO_IMM(0x3));
+    TEST_EQ(inst, 0x0f, 0x00, 0x30, 0x02);
+
+    inst = RISCV64_INST(RV_FENCE, RO_IMM(0x3), RO_IMM(0x1));
+    TEST_EQ(inst, 0x0f, 0x00, 0x10, 0x03);
 }
 
 int main(void) {
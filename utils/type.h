@@ -431,16 +431,19 @@ typedef struct {
 } waitq_t;
 
 /**
- * buf 采用环形队列设计，添加 buf_len 记录当前元素数量， buf_cap 记录队列大小
- *
+ * buf 采用无锁环形队列设计(bounded mpmc), buf 长度为不小于 buf_cap 的 2 的幂, buf_seqs 记录每个槽位的序号,
+ * buf_front/buf_rear 单调递增，通过 & buf_mask 得到数组索引
  */
 typedef struct {
     n_vec_t *buf;
     waitq_t sendq;
     waitq_t recvq;
+    n_vec_t *buf_seqs;
 
-    int64_t buf_front; // 队列首元素对应的数组索引
-    int64_t buf_rear;
+    uint64_t buf_front; // 下一个读取的位置
+    uint64_t buf_rear; // 下一个写入的位置
+    uint64_t buf_cap; // 为 0 时表示无缓冲 chan
+    uint64_t buf_mask;
 
     int64_t msg_size;
     pthread_mutex_t lock;